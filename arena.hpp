@@ -0,0 +1,90 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+/*
+Bump-pointer arena. The driver owns one arena per compilation and every node
+of the abstract syntax tree is allocated from it. Nodes are never freed one at
+a time: the whole arena is released in one shot when the compilation is done.
+No destructors run then, so what is allocated here must not own memory elsewhere.
+*/
+class Arena
+{
+    private:
+    static const size_t CHUNK_SIZE = 64 * 1024;
+
+    std::vector<char*> chunks;
+    char *cur = nullptr;
+    char *end = nullptr;
+
+    // Allocation counters, reported by the driver with --stats
+    size_t allocations = 0;
+    size_t bytesUsed = 0;
+    size_t bytesReserved = 0;
+
+    void newChunk(size_t minSize) {
+        size_t size = minSize > CHUNK_SIZE ? minSize : CHUNK_SIZE;
+        char *chunk = static_cast<char*>(std::malloc(size));
+        if (chunk == nullptr) {
+            throw std::bad_alloc();
+        }
+        chunks.push_back(chunk);
+        cur = chunk;
+        end = chunk + size;
+        bytesReserved += size;
+    }
+
+    public:
+    Arena() = default;
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    ~Arena() {
+        release();
+    }
+
+    void *allocate(size_t size, size_t align = alignof(std::max_align_t)) {
+        size_t pad = (align - reinterpret_cast<size_t>(cur) % align) % align;
+        if (cur == nullptr || size + pad > static_cast<size_t>(end - cur)) {
+            newChunk(size + align);
+            pad = (align - reinterpret_cast<size_t>(cur) % align) % align;
+        }
+        char *ptr = cur + pad;
+        cur = ptr + size;
+        allocations++;
+        bytesUsed += size;
+        return ptr;
+    }
+
+    // Frees all chunks at once
+    void release() {
+        for (char *chunk : chunks) {
+            std::free(chunk);
+        }
+        chunks.clear();
+        cur = end = nullptr;
+        allocations = bytesUsed = bytesReserved = 0;
+    }
+
+    size_t numAllocations() const {
+        return allocations;
+    }
+
+    size_t numBytes() const {
+        return bytesUsed;
+    }
+
+    size_t numReserved() const {
+        return bytesReserved;
+    }
+
+    size_t numChunks() const {
+        return chunks.size();
+    }
+};
+
+#endif
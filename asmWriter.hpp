@@ -0,0 +1,145 @@
+#ifndef ASM_WRITER_HPP
+#define ASM_WRITER_HPP
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/*
+Text buffer made of fixed size chunks. Appending never moves what is already
+in the buffer, and writing it out keeps the chunks for the next contents, so a
+buffer that is filled and written over and over only allocates for its largest
+contents.
+*/
+class Chunks
+{
+    private:
+    static const size_t CHUNK_SIZE = 1 << 16;
+
+    std::vector<std::unique_ptr<char[]>> chunks;
+    size_t full = 0;    // Chunks filled up
+    size_t used = 0;    // Bytes used in the chunk after them
+
+    public:
+    Chunks& append(const char *bytes, size_t length) {
+        while (length > 0) {
+            if (full == chunks.size()) {
+                chunks.emplace_back(new char[CHUNK_SIZE]);
+            }
+            size_t n = std::min(length, CHUNK_SIZE - used);
+            memcpy(chunks[full].get() + used, bytes, n);
+            used += n;
+            bytes += n;
+            length -= n;
+            if (used == CHUNK_SIZE) {
+                full++;
+                used = 0;
+            }
+        }
+        return *this;
+    }
+
+    Chunks& append(const std::string& text) {
+        return append(text.data(), text.size());
+    }
+
+    Chunks& append(const char *text) {
+        return append(text, strlen(text));
+    }
+
+    size_t size() const {
+        return full * CHUNK_SIZE + used;
+    }
+
+    // Bytes allocated for the chunks
+    size_t capacity() const {
+        return chunks.size() * CHUNK_SIZE;
+    }
+
+    // Writes the contents to out a chunk at a time and empties the buffer
+    void writeTo(std::ostream& out) {
+        for (size_t i = 0; i < full; i++) {
+            out.write(chunks[i].get(), CHUNK_SIZE);
+        }
+        if (used > 0) {
+            out.write(chunks[full].get(), used);
+        }
+        full = 0;
+        used = 0;
+    }
+};
+
+/*
+Writes the assembly file while the code is generated. The code of each function
+and the .data lines it needs are added to the text and data buffers once the
+function is done, and both are written to the file whenever they hold enough for
+large writes. Data and code of different functions end up in separate .data and
+.text runs, which the assembler puts back together. Only the code of main is held
+to the end, so that it comes last with the exit code after it.
+*/
+class AsmWriter
+{
+    private:
+    static const size_t FLUSH_SIZE = 1 << 18;
+
+    enum class Section { DATA, TEXT };
+
+    std::ostream* out = nullptr;
+    Section section = Section::DATA;
+
+    void switchTo(Section next) {
+        if (section != next) {
+            out->write(next == Section::TEXT ? "\n\t.text\n" : "\t.data\n", next == Section::TEXT ? 8 : 7);
+            section = next;
+        }
+    }
+
+    void flush() {
+        if (data.size() > 0) {
+            switchTo(Section::DATA);
+            data.writeTo(*out);
+        }
+        if (text.size() > 0) {
+            switchTo(Section::TEXT);
+            text.writeTo(*out);
+        }
+    }
+
+    public:
+    Chunks data;    // .data lines not written yet
+    Chunks text;    // Code of the functions not written yet
+    Chunks main;    // Code of main
+
+    // Starts the file in the data section
+    void begin(std::ostream& file) {
+        out = &file;
+        section = Section::DATA;
+        out->write("\t.globl main\n\t.data\n", 20);
+    }
+
+    // Called once the code of a function is added
+    void endFunction() {
+        if (data.size() + text.size() >= FLUSH_SIZE) {
+            flush();
+        }
+    }
+
+    // Writes what is left, with the code of main last behind mainStart
+    void finish(const std::string& mainStart) {
+        flush();
+        switchTo(Section::TEXT);
+        out->write(mainStart.data(), mainStart.size());
+        main.writeTo(*out);
+        out = nullptr;
+    }
+
+    // Bytes allocated for the buffers, reported with --stats
+    size_t memoryUsed() const {
+        return data.capacity() + text.capacity() + main.capacity();
+    }
+};
+
+#endif
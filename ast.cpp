@@ -3,4 +3,9 @@
 #include <vector>
 #include "ast.hpp"
 // Keeps track of indent spacing for printing the output
-int INDENTS = 0;
\ No newline at end of file
+int INDENTS = 0;
+// Arena that all nodes are allocated from, set by the driver
+Arena *AST::arena = nullptr;
+size_t AST::numNodes = 0, AST::nodeBytes = 0;
+// Identifier interning table shared by the scanner and every later pass
+Interner interner;
\ No newline at end of file
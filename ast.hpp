@@ -1,15 +1,46 @@
 #ifndef AST_HPP
 #define AST_HPP
 
+#include <cstdint>
+#include <cstring>
 #include <iostream>
+#include <type_traits>
 #include <vector>
-#include <algorithm>
+#include "arena.hpp"
+#include "intern.hpp"
 #define INDENT_CHAR ' '
 extern int INDENTS;
 
+struct entry;
+
 
 enum Oper : uint8_t { ADD, SUB, DIV, MULT, MOD, LT, GT, LE, GE, EQ, NEQ, NOT, AND, OR};
 enum Reserved : uint8_t {TRUE, FALSE, BOOL, INT, VOID, IF, ELSE, WHILE, BREAK, RETURN};
+// Tag stored on every AST node, set once at construction
+enum class NodeKind : uint8_t {PROG, BLOCK, IF_STMT, ELSE_STMT, WHILE_STMT, ASSN_STMT, NULL_STMT, BREAK_STMT, RET_STMT,
+                               ID, NUM, LITERAL, STRING_LIT, ARITHMETIC, COMPARE, LOGICAL, FUNC_CALL,
+                               MAIN_DECL, FUNC_DECL, VAR_DECL, PARAM};
+// Type of a declaration or of an expression. Main has no type, neither do unknown
+// names. UNCHECKED marks an expression the type checker hasn't reached yet.
+enum class Type : uint8_t {NONE, INT, BOOLEAN, VOID, STRING, UNCHECKED};
+
+inline std::string typeName(Type type) {
+    switch (type) {
+        case Type::INT: return "int";
+        case Type::BOOLEAN: return "boolean";
+        case Type::VOID: return "void";
+        case Type::STRING: return "string";
+        default: return "";
+    }
+}
+
+inline Type typeOf(const std::string& name) {
+    if (name == "int") return Type::INT;
+    if (name == "boolean") return Type::BOOLEAN;
+    if (name == "void") return Type::VOID;
+    if (name == "string") return Type::STRING;
+    return Type::NONE;
+}
 
 inline std::string getOper(uint8_t oper) {
     switch(oper) {
@@ -81,43 +112,82 @@ class AST;
     class VarDecl;
     class Param;
 
+/*
+Children of a node, in an array allocated from the node arena like the nodes
+themselves. Adding a child to a full array moves them all to one twice as large
+and leaves the old one to the arena, so a node owns no heap memory and needs no
+destructor.
+*/
+class ChildList
+{
+    private:
+    AST **items = nullptr;
+    uint32_t count = 0;
+    uint32_t capacity = 0;
+
+    public:
+    inline void push_back(AST *child);
+
+    size_t size() const {
+        return count;
+    }
+
+    AST *operator[](size_t i) const {
+        return items[i];
+    }
+
+    AST *&operator[](size_t i) {
+        return items[i];
+    }
+
+    AST *const *begin() const {
+        return items;
+    }
+
+    AST *const *end() const {
+        return items + count;
+    }
+
+    // Drops the children from the nth on
+    void truncate(size_t n) {
+        count = n;
+    }
+};
+
 class AST
 {
     protected:
 
-    std::vector<AST*> children;
+    ChildList children;
+    NodeKind kind;
+    // Type of the expression this node is, found once by the type checker
+    Type exprType = Type::UNCHECKED;
     
     virtual void AddChild(AST *child) = 0;
     u_int8_t type;
-    std::string name;
+    Symbol symbol = NO_SYMBOL;
     int lineno;
-    AST * next;
-    void * memoryLoc;
+    // Symbol table entry of the declaration this node declares or refers to
+    entry* decl = nullptr;
 
     public:
 
-    virtual int numChildren() {
+    int numChildren() const {
         return children.size();
     }
-    virtual std::vector<AST*> getChildren() {
+    const ChildList& getChildren() const {
         return children;
     }
-
-    virtual AST * getNext() {
-        return next;
+    AST* getChild(int i) const {
+        return children[i];
     }
-
-    virtual bool hasNext() {
-        if (next != NULL) {
-            return true;
-        }
-        else {
-            return false;
-        }
+    // Replaces a child, for the passes that rewrite the tree before code generation
+    void setChild(int i, AST* child) {
+        children[i] = child;
     }
-
-    virtual void setNext(AST* ast) {
-        next = ast;
+    // Drops the children from the nth on
+    void truncateChildren(int n) {
+        children.truncate(n);
     }
 
     virtual int getLineNo() {
@@ -128,57 +198,99 @@ class AST
         return "";
     }
 
-    virtual std::string getNodeType() {
-        return "";
+    NodeKind getKind() const {
+        return kind;
+    }
+
+    Type getExprType() const {
+        return exprType;
+    }
+
+    void setExprType(Type t) {
+        exprType = t;
     }
 
     virtual std::string getValue() {
         return "";
     }
 
-    virtual std::string getName() {
-        return name;
+    Symbol getSymbol() const {
+        return symbol;
+    }
+
+    StrRef getName() const {
+        return interner.name(symbol);
     }
 
     virtual void setType(u_int8_t t) {
         type = t;
     }
 
-    virtual void setLoc(void* loc) {
-        memoryLoc = loc;
+    entry* getDecl() const {
+        return decl;
     }
 
-    virtual void reverseChildren() {
-        for (auto child : children) {   
-            child->reverseChildren();
-        }
+    void setDecl(entry* e) {
+        decl = e;
     }
 
     virtual int getParamNum() {return 0;}
 
-    virtual void addParam() {}
-
     virtual void setParamNum(int p) {}
 
-    AST() = default;
+    // Every node is allocated from the arena owned by the driver. Nodes are
+    // never deleted one by one, and hold nothing that needs destroying, so the
+    // arena frees them all with its chunks when it is released.
+    static Arena *arena;
+    // Nodes allocated and their bytes, reported with --stats apart from the
+    // rest of the arena, such as child arrays and string copies
+    static size_t numNodes, nodeBytes;
 
-    virtual ~AST()
-    {
-        for (auto child : children)
-        {
-            delete child;
-        }
-        children.clear();
+    static void *operator new(std::size_t size) {
+        numNodes++;
+        nodeBytes += size;
+        return arena->allocate(size);
     }
 
+    static void operator delete(void *ptr) {}
+
+    AST(NodeKind k) : kind(k) {}
+
     virtual void AddNode(AST *child) = 0;
-    virtual void Print() = 0;
+
+    // Prints this node's own line, indented by INDENTS
+    virtual void printNode() = 0;
+
+    // Prints this node and everything under it, each node indented one level
+    // deeper than its parent. The path to the current node is kept on an explicit
+    // stack, so printing deeply nested trees doesn't overflow the native stack.
+    void Print() {
+        int baseIndent = INDENTS;
+        std::vector<std::pair<AST*, size_t>> path;
+        printNode();
+        path.push_back({this, 0});
+        while (!path.empty()) {
+            AST *node = path.back().first;
+            size_t next = path.back().second;
+            if (next < node->children.size()) {
+                path.back().second++;
+                AST *child = node->children[next];
+                INDENTS = baseIndent + path.size();
+                child->printNode();
+                path.push_back({child, 0});
+            }
+            else {
+                path.pop_back();
+            }
+        }
+        INDENTS = baseIndent;
+    }
 };
 
 class Prog : public AST
 {
     private:
-    std::string prog_name;  
+    const char *prog_name;  
 
     protected:
     void AddChild(AST *child) override
@@ -188,30 +300,17 @@ class Prog : public AST
     }
 
     public:
-    Prog(const char* const str) : prog_name(str) {};
+    Prog(const char* const str) : AST(NodeKind::PROG), prog_name(str) {};
 
     void AddNode(AST *node) override
     {
         AddChild(node);
     }
 
-    void reverseChildren() override {
-        std::reverse(children.begin(), children.end());
-        for (auto child : children) {   
-            child->reverseChildren();
-        }
-    }
-
-    void Print() override
+    void printNode() override
     {
         std::cout << std::string(INDENTS*2, INDENT_CHAR);
         std::cout << "--Program: {'filename': " << prog_name << "}" << "\n";
-        INDENTS++;
-        for (auto child : children) {   
-            child->Print();
-        }
-        INDENTS--;
-
     }
 };
 
@@ -219,7 +318,6 @@ class IfStmt : public AST {
 
     protected:
     int lineno;
-    std::string nodeType = "if";
 
     void AddChild(AST *child) override
     {
@@ -228,11 +326,7 @@ class IfStmt : public AST {
     }
 
     public:
-    IfStmt(int line) : lineno(line) {};
-
-    std::string getNodeType() override {
-        return nodeType;
-    }
+    IfStmt(int line) : AST(NodeKind::IF_STMT), lineno(line) {};
 
     int getLineNo() override {
         return lineno;
@@ -243,16 +337,10 @@ class IfStmt : public AST {
         AddChild(node);
     }
 
-    void Print() override
+    void printNode() override
     {
         std::cout << std::string(INDENTS*2, INDENT_CHAR);
         std::cout << "--If Statement {'lineno': " << lineno << "}" << "\n";
-        INDENTS++;
-        for (auto child : children)
-        {
-            child->Print();
-        }
-        INDENTS--;
     }
 };
 
@@ -260,7 +348,6 @@ class ElseStmt : public AST {
 
     protected:
     int lineno;
-    std::string nodeType = "else";
 
     void AddChild(AST *child) override
     {
@@ -269,11 +356,7 @@ class ElseStmt : public AST {
     }
 
     public:
-    ElseStmt(int line) : lineno(line) {};
-
-    std::string getNodeType() override {
-        return nodeType;
-    }
+    ElseStmt(int line) : AST(NodeKind::ELSE_STMT), lineno(line) {};
 
     int getLineNo() override {
         return lineno;
@@ -284,16 +367,10 @@ class ElseStmt : public AST {
         AddChild(node);
     }
 
-    void Print() override
+    void printNode() override
     {
         std::cout << std::string(INDENTS*2, INDENT_CHAR);
         std::cout << "--Else Statement {'lineno': " << lineno << "}" << "\n";
-        INDENTS++;
-        for (int i = children.size(); i --> 0;)
-        {
-            children[i]->Print();
-        }
-        INDENTS--;
     }
 };
 
@@ -301,7 +378,6 @@ class WhileStmt : public AST {
 
     protected:
     int lineno;
-    std::string nodeType = "while";
 
     void AddChild(AST *child) override
     {
@@ -309,14 +385,8 @@ class WhileStmt : public AST {
 
     }
 
-    std::string conditional;
-
     public:
-    WhileStmt(int line) : lineno(line) {};
-
-    std::string getNodeType() override {
-        return nodeType;
-    }
+    WhileStmt(int line) : AST(NodeKind::WHILE_STMT), lineno(line) {};
 
     int getLineNo() override {
         return lineno;
@@ -327,16 +397,10 @@ class WhileStmt : public AST {
         AddChild(node);
     }
 
-    void Print() override
+    void printNode() override
     {
         std::cout << std::string(INDENTS*2, INDENT_CHAR);
         std::cout << "--While Statement {'lineno': " << lineno << "}" << "\n";
-        INDENTS++;
-        for (auto child :children)
-        {
-            child->Print();
-        }
-        INDENTS--;
     }
 };
 
@@ -344,7 +408,6 @@ class Block : public AST {
 
     protected:
     int lineno;
-    std::string nodeType = "block";
 
     void AddChild(AST *child) override
     {
@@ -353,11 +416,7 @@ class Block : public AST {
     }
 
     public:
-    Block(int line) : lineno(line) {};
-
-    std::string getNodeType() override {
-        return nodeType;
-    }
+    Block(int line) : AST(NodeKind::BLOCK), lineno(line) {};
 
     int getLineNo() override {
         return lineno;
@@ -368,23 +427,10 @@ class Block : public AST {
         AddChild(node);
     }
 
-    void reverseChildren() override {
-        std::reverse(children.begin(), children.end());
-        for (auto child : children) {   
-            child->reverseChildren();
-        }
-    }
-
-    void Print() override
+    void printNode() override
     {
         std::cout << std::string(INDENTS*2, INDENT_CHAR);
         std::cout << "--Block: {'lineno': " << lineno << "}" << "\n";
-        INDENTS++;
-        for (auto child : children)
-        {
-            child->Print();
-        }
-        INDENTS--;
     }
 };
 
@@ -392,9 +438,7 @@ class AssnStmt : public AST {
 
     protected:
     int lineno;
-    std::string nodeType = "assnstmt";
 
-    std::string identifier;
 
     void AddChild(AST *child) override
     {
@@ -404,11 +448,9 @@ class AssnStmt : public AST {
 
     public:
 
-    AssnStmt(int line, const char* const id) : lineno(line), identifier(id) {};
-
-    std::string getNodeType() override {
-        return nodeType;
-    }
+    AssnStmt(int line, Symbol id) : AST(NodeKind::ASSN_STMT), lineno(line) {
+        symbol = id;
+    };
 
     int getLineNo() override {
         return lineno;
@@ -419,20 +461,10 @@ class AssnStmt : public AST {
         AddChild(node);
     }
 
-    std::string getName() override {
-        return identifier;
-    }
-
-    void Print() override
+    void printNode() override
     {
         std::cout << std::string(INDENTS*2, INDENT_CHAR);
-        std::cout << "--Assign Statement {'Id': " << identifier << ", 'lineno': " << lineno << "}" << "\n";
-        INDENTS++;
-        for (auto child : children)
-        {
-            child->Print();
-        }
-        INDENTS--;
+        std::cout << "--Assign Statement {'Id': " << getName() << ", 'lineno': " << lineno << "}" << "\n";
     }
 };
 
@@ -440,7 +472,6 @@ class NullStmt : public AST {
 
     protected:
     int lineno;
-    std::string nodeType = "null";
 
     void AddChild(AST *child) override
     {
@@ -449,11 +480,7 @@ class NullStmt : public AST {
     }
 
     public:
-    NullStmt(int line) : lineno(line) {};
-
-    std::string getNodeType() override {
-        return nodeType;
-    }
+    NullStmt(int line) : AST(NodeKind::NULL_STMT), lineno(line) {};
 
     int getLineNo() override {
         return lineno;
@@ -464,16 +491,10 @@ class NullStmt : public AST {
         AddChild(node);
     }
 
-    void Print() override
+    void printNode() override
     {
         std::cout << std::string(INDENTS*2, INDENT_CHAR);
         std::cout << "--Null Statement {'lineno': " << lineno << "}" << "\n";
-        INDENTS++;
-        for (auto child : children)
-        {
-            child->Print();
-        }
-        INDENTS--;
     }
 };
 
@@ -481,7 +502,6 @@ class BreakStmt : public AST {
 
     protected:
     int lineno;
-    std::string nodeType = "break";
 
     void AddChild(AST *child) override
     {
@@ -490,11 +510,7 @@ class BreakStmt : public AST {
     }
 
     public:
-    BreakStmt(int line) : lineno(line) {};
-
-    std::string getNodeType() override {
-        return nodeType;
-    }
+    BreakStmt(int line) : AST(NodeKind::BREAK_STMT), lineno(line) {};
 
     int getLineNo() override {
         return lineno;
@@ -505,16 +521,10 @@ class BreakStmt : public AST {
         AddChild(node);
     }
 
-    void Print() override
+    void printNode() override
     {
         std::cout << std::string(INDENTS*2, INDENT_CHAR);
         std::cout << "--Break Statement {'lineno': " << lineno << "}" << "\n";
-        INDENTS++;
-        for (auto child : children)
-        {
-            child->Print();
-        }
-        INDENTS--;
     }
 };
 
@@ -522,7 +532,6 @@ class RetStmt : public AST {
 
     protected:
     int lineno;
-    std::string nodeType = "return";
 
     void AddChild(AST *child) override
     {
@@ -532,11 +541,7 @@ class RetStmt : public AST {
 
     public:
 
-    RetStmt(int line) : lineno(line) {};
-
-    std::string getNodeType() override {
-        return nodeType;
-    }
+    RetStmt(int line) : AST(NodeKind::RET_STMT), lineno(line) {};
 
     int getLineNo() override {
         return lineno;
@@ -547,24 +552,16 @@ class RetStmt : public AST {
         AddChild(node);
     }
 
-    void Print() override
+    void printNode() override
     {
         std::cout << std::string(INDENTS*2, INDENT_CHAR);
         std::cout << "--Return Statement {'lineno': " << lineno << "}" << "\n";
-        INDENTS++;
-        for (auto child : children)
-        {
-            child->Print();
-        }
-        INDENTS--;
     }
 };
 
 class MainDecl : public AST
 {
     protected:
-    std::string name;
-    std::string nodeType = "maindecl";
     u_int8_t type = 0;
     int lineno;
 
@@ -575,20 +572,14 @@ class MainDecl : public AST
     }
 
     public:
-    MainDecl(int line, const char* const str) : lineno(line), name(str) {};
-
-    std::string getNodeType() override {
-        return nodeType;
-    }
+    MainDecl(int line, Symbol id) : AST(NodeKind::MAIN_DECL), lineno(line) {
+        symbol = id;
+    };
 
     int getLineNo() override {
         return lineno;
     }
 
-    std::string getName() override {
-        return name;
-    }
-
     std::string getType() override {
         return "";
     }
@@ -598,30 +589,15 @@ class MainDecl : public AST
         AddChild(node);
     }
 
-    void reverseChildren() override {
-        std::reverse(children.begin(), children.end());
-        for (auto child : children) {   
-            child->reverseChildren();
-        }
-    }
-
-    void Print() override {
+    void printNode() override {
         std::cout << std::string(INDENTS*2, INDENT_CHAR);
-        std::cout << "--Main Function Declaration: {'name': " << name << ", 'lineno': " << lineno << ", 'memLoc': " << memoryLoc << "}" << "\n";
-        INDENTS++;
-        for (auto child : children)
-        {
-            child->Print();
-        }
-        INDENTS--;
+        std::cout << "--Main Function Declaration: {'name': " << getName() << ", 'lineno': " << lineno << ", 'memLoc': " << decl << "}" << "\n";
     }
 };
 
 class VarDecl : public AST
 {
     protected:
-    std::string name;
-    std::string nodeType = "vardecl";
     u_int8_t type;
     int lineno;
 
@@ -632,15 +608,9 @@ class VarDecl : public AST
     }
 
     public:
-    VarDecl(int line, u_int8_t t, const char* const id) : lineno(line), name(std::string(id)), type(t) {};
-
-    std::string getNodeType() override {
-        return nodeType;
-    }
-
-    std::string getName() override {
-        return name;
-    }
+    VarDecl(int line, u_int8_t t, Symbol id) : AST(NodeKind::VAR_DECL), lineno(line), type(t) {
+        symbol = id;
+    };
 
     int getLineNo() override {
         return lineno;
@@ -655,56 +625,37 @@ class VarDecl : public AST
         AddChild(node);
     }
 
-    void Print() override {
+    void printNode() override {
         std::cout << std::string(INDENTS*2, INDENT_CHAR);
-        std::cout << "--Variable Declaration: {'type': " << getReserved(type) << ", 'id': " << name << ", 'lineno': " << lineno << ", 'memLoc': " << memoryLoc  << "}" << "\n";
-        INDENTS++;
-        for (auto child : children)
-        {
-            child->Print();
-        }
-        INDENTS--;
+        std::cout << "--Variable Declaration: {'type': " << getReserved(type) << ", 'id': " << getName() << ", 'lineno': " << lineno << ", 'memLoc': " << decl  << "}" << "\n";
     }
 };
 
 class FuncDecl : public AST
 {
     protected:
-    std::string name;
-    std::string nodeType = "funcdecl";
     u_int8_t type;
     int lineno, numOfParams = 0;
 
+    // Parameters are added in source order before the body, and numbered as they come
     void AddChild(AST *child) override
     {   
-        if (child->getNodeType() == "param" || child->getNodeType() == "id") {
-            children.insert(children.begin(), child);
-        }
-        else {
-            children.push_back(child);
+        if (child->getKind() == NodeKind::PARAM) {
+            child->setParamNum(++numOfParams);
         }
+        children.push_back(child);
 
     }
 
     public:
-    FuncDecl(int line, const char* const id) : lineno(line), name(std::string(id)) {};
-
-    std::string getNodeType() override {
-        return nodeType;
-    }
+    FuncDecl(int line, Symbol id) : AST(NodeKind::FUNC_DECL), lineno(line) {
+        symbol = id;
+    };
 
     int getLineNo() override {
         return lineno;
     }
 
-    std::string getName() override {
-        return name;
-    }
-
-    void addParam() override {
-        numOfParams++;
-    }
-
     std::string getType() override {
         return getReserved(type);
     }
@@ -717,79 +668,38 @@ class FuncDecl : public AST
         type = t;
     }
 
-    void reverseChildren() override {
-        for (int i = 0; i < children.size(); i++) {
-            if (i < numOfParams) {
-                children.at(i)->setParamNum(i+1);
-            }  
-            children.at(i)->reverseChildren();
-        }
-    }
-
-    void Print() override {
+    void printNode() override {
         std::cout << std::string(INDENTS*2, INDENT_CHAR);
-        std::cout << "--Function Declaration {'return type': " << getReserved(type) << ", 'id': " << name  << ", 'lineno': " << lineno << ", 'memLoc': " << memoryLoc << "}" << "\n";
-        INDENTS++;
-        for (auto child : children)
-        {
-            child->Print();
-        }
-        INDENTS--;
+        std::cout << "--Function Declaration {'return type': " << getReserved(type) << ", 'id': " << getName()  << ", 'lineno': " << lineno << ", 'memLoc': " << decl << "}" << "\n";
     }
 };
 
 class Param : public AST
 {
     protected:
-    std::string name;
-    std::string nodeType = "param";
     u_int8_t type;
     int lineno, paramNum;
-    AST* next;
 
     void AddChild(AST *child) override
     {
-        children.insert(children.begin(), child);
+        children.push_back(child);
 
     }
 
     public:
-    Param(int line, u_int8_t t, const char* const id) : lineno(line), name(std::string(id)), type(t) {};
-
-    std::string getNodeType() override {
-        return nodeType;
-    }
+    Param(int line, u_int8_t t, Symbol id) : AST(NodeKind::PARAM), lineno(line), type(t) {
+        symbol = id;
+    };
 
     int getLineNo() override {
         return lineno;
     }
 
-    std::string getName() override {
-        return name;
-    }
-
     void AddNode(AST *node) override
     {
         AddChild(node);
     }
 
-    AST * getNext() override {
-        return next;
-    }
-
-    bool hasNext() override {
-        if (next != NULL) {
-            return true;
-        }
-        else {
-            return false;
-        }
-    }
-
-    void setNext(AST* ast) override {
-        next = ast;
-    }
-
     int getParamNum() override{
         return paramNum;
     }
@@ -802,22 +712,15 @@ class Param : public AST
         paramNum = p;
     }
 
-    void Print() override {
+    void printNode() override {
         std::cout << std::string(INDENTS*2, INDENT_CHAR);
-        std::cout << "--Formal Parameter {'type': " << getReserved(type) << ", 'id': " << name << ", 'lineno': " << lineno << ", 'memLoc': " << memoryLoc << "}" << "\n";
-        INDENTS++;
-        for (int i = children.size(); i --> 0;)
-        {
-            children[i]->Print();
-        }
-        INDENTS--;
+        std::cout << "--Formal Parameter {'type': " << getReserved(type) << ", 'id': " << getName() << ", 'lineno': " << lineno << ", 'memLoc': " << decl << "}" << "\n";
     }
 };
 
 class Num : public AST {
   protected:
     int value, lineno;
-    std::string nodeType = "num";
 
     void AddChild(AST *child) override
     {
@@ -826,11 +729,7 @@ class Num : public AST {
     }
 
   public:
-    Num(int line, int val) : lineno(line), value(val) {}
-
-    std::string getNodeType() override {
-        return nodeType;
-    }
+    Num(int line, int val) : AST(NodeKind::NUM), lineno(line), value(val) {}
 
     int getLineNo() override {
         return lineno;
@@ -849,15 +748,9 @@ class Num : public AST {
         return std::to_string(value);
     }
 
-    void Print() override {
+    void printNode() override {
         std::cout << std::string(INDENTS*2, INDENT_CHAR);
         std::cout << "--Num {'value': " << value << ", 'lineno': " << lineno << "}" << "\n";
-        INDENTS++;
-        for (auto child : children)
-        {
-            child->Print();
-        }
-        INDENTS--;
     }
 };
 
@@ -865,7 +758,6 @@ class Literal : public AST {
   protected:
     u_int8_t value;
     int lineno;
-    std::string nodeType = "literal";
 
     void AddChild(AST *child) override
     {
@@ -874,11 +766,7 @@ class Literal : public AST {
     }
 
   public:
-    Literal(int line, u_int8_t val) : lineno(line), value(val) {}
-
-    std::string getNodeType() override {
-        return nodeType;
-    }
+    Literal(int line, u_int8_t val) : AST(NodeKind::LITERAL), lineno(line), value(val) {}
 
     int getLineNo() override {
         return lineno;
@@ -903,21 +791,15 @@ class Literal : public AST {
         return getReserved(value);
     }
 
-    void Print() override {
+    void printNode() override {
         std::cout << std::string(INDENTS*2, INDENT_CHAR);
         std::cout << "--Literal {'value': " << getReserved(value)  << ", 'lineno': " << lineno << "}" << "\n";
-        INDENTS++;
-        for (auto child : children)
-        {
-            child->Print();
-        }
-        INDENTS--;
     }
 };
 
 class String : public AST {
   protected:
-    std::string value, nodeType = "string";
+    StrRef value;
     int lineno;
 
     void AddChild(AST *child) override
@@ -927,12 +809,8 @@ class String : public AST {
     }
 
   public:
-    String(int line, const char* const val) : lineno(line), value(val) {}
+    String(int line, StrRef val) : AST(NodeKind::STRING_LIT), lineno(line), value(val) {}
     
-    std::string getNodeType() override {
-        return nodeType;
-    }
-
     int getLineNo() override {
         return lineno;
     }
@@ -943,79 +821,41 @@ class String : public AST {
     }
 
     std::string getValue() override {
-        return value;
+        return value.str();
     }
 
-    void Print() override {
+    void printNode() override {
         std::cout << std::string(INDENTS*2, INDENT_CHAR);
         std::cout << "--String Literal {'value': " << value << ", 'lineno': " << lineno << "}" << "\n";
-        INDENTS++;
-        for (auto child : children)
-        {
-            child->Print();
-        }
-        INDENTS--;
     }
 };
 
 class Id : public AST {
   protected:
-    std::string id, nodeType = "id";
     int lineno;
 
     void AddChild(AST *child) override
     {
-        children.insert(children.begin(), child);
+        children.push_back(child);
 
     }
 
-    AST* next;
-
   public:
-    Id(int line, const char* const value) : lineno(line), id(std::string(value)) {}
-
-    std::string getNodeType() override {
-        return nodeType;
-    }
-
-    std::string getName() override {
-        return id;
+    Id(int line, Symbol value) : AST(NodeKind::ID), lineno(line) {
+        symbol = value;
     }
 
     int getLineNo() override {
         return lineno;
     }
 
-    AST * getNext() override {
-        return next;
-    }
-
-    bool hasNext() override {
-        if (next != NULL) {
-            return true;
-        }
-        else {
-            return false;
-        }
-    }
-
-    void setNext(AST* ast) override {
-        next = ast;
-    }
-
     void AddNode(AST *node) override {
         AddChild(node);
     }
 
-    void Print() override {
+    void printNode() override {
         std::cout << std::string(INDENTS*2, INDENT_CHAR);
-        std::cout << "--Id {'name': " << id << ", 'lineno': " << lineno << "}" << "\n";
-        INDENTS++;
-        for (auto child : children)
-        {
-            child->Print();
-        }
-        INDENTS--;
+        std::cout << "--Id {'name': " << getName() << ", 'lineno': " << lineno << "}" << "\n";
     }
 };
 
@@ -1023,7 +863,6 @@ class Compare : public AST {
   protected:
     u_int8_t type;
     int lineno;
-    std::string nodeType = "compare";
 
     void AddChild(AST *child) override
     {
@@ -1032,11 +871,7 @@ class Compare : public AST {
     }
 
   public:
-    Compare(int line, u_int8_t t) : lineno(line), type(t) {}
-
-    std::string getNodeType() override {
-        return nodeType;
-    }
+    Compare(int line, u_int8_t t) : AST(NodeKind::COMPARE), lineno(line), type(t) {}
 
     int getLineNo() override {
         return lineno;
@@ -1051,15 +886,9 @@ class Compare : public AST {
         return getOper(type);
     }
 
-    void Print() override {
+    void printNode() override {
         std::cout << std::string(INDENTS*2, INDENT_CHAR);
         std::cout << "--Comparison operator {'type': " << getOper(type) << ", 'lineno': " << lineno << "}" << "\n";
-        INDENTS++;
-        for (auto child : children)
-        {
-            child->Print();
-        }
-        INDENTS--;
     }
 };
 
@@ -1067,7 +896,6 @@ class Arithmetic : public AST {
   protected:
     u_int8_t type;
     int lineno;
-    std::string nodeType = "arithmetic";
 
     void AddChild(AST *child) override
     {
@@ -1076,11 +904,7 @@ class Arithmetic : public AST {
     }
 
   public:
-    Arithmetic(int line, u_int8_t t) : lineno(line), type(t) {}
-
-    std::string getNodeType() override {
-        return nodeType;
-    }
+    Arithmetic(int line, u_int8_t t) : AST(NodeKind::ARITHMETIC), lineno(line), type(t) {}
 
     int getLineNo() override {
         return lineno;
@@ -1095,15 +919,9 @@ class Arithmetic : public AST {
         return getOper(type);
     }
 
-    void Print() override {
+    void printNode() override {
         std::cout << std::string(INDENTS*2, INDENT_CHAR);
         std::cout << "--Arithmetic operator {'type': " << getOper(type) << ", 'lineno': " << lineno << "}" << "\n";
-        INDENTS++;
-        for (auto child : children)
-        {
-            child->Print();
-        }
-        INDENTS--;
     }
 };
 
@@ -1111,7 +929,6 @@ class Logical : public AST {
   protected:
     u_int8_t type;
     int lineno;
-    std::string nodeType = "logical";
 
     void AddChild(AST *child) override
     {
@@ -1120,11 +937,7 @@ class Logical : public AST {
     }
 
   public:
-    Logical(int line, u_int8_t t) : lineno(line), type(t) {}
-
-    std::string getNodeType() override {
-        return nodeType;
-    }
+    Logical(int line, u_int8_t t) : AST(NodeKind::LOGICAL), lineno(line), type(t) {}
 
     int getLineNo() override {
         return lineno;
@@ -1139,21 +952,14 @@ class Logical : public AST {
         return getOper(type);
     }
 
-    void Print() override {
+    void printNode() override {
         std::cout << std::string(INDENTS*2, INDENT_CHAR);
         std::cout << "--Logical operator {'type': " << getOper(type) << ", 'lineno': " << lineno << "}" << "\n";
-        INDENTS++;
-        for (auto child : children)
-        {
-            child->Print();
-        }
-        INDENTS--;
     }
 };
 
 class FuncCall : public AST {
   protected:
-    std::string id, nodeType = "funccall";
     int lineno;
 
     void AddChild(AST *child) override
@@ -1163,10 +969,8 @@ class FuncCall : public AST {
     }
 
   public:
-    FuncCall(int line, const char* const value) : lineno(line), id(std::string(value)) {}
-
-    std::string getNodeType() override {
-        return nodeType;
+    FuncCall(int line, Symbol value) : AST(NodeKind::FUNC_CALL), lineno(line) {
+        symbol = value;
     }
 
     int getLineNo() override {
@@ -1178,26 +982,26 @@ class FuncCall : public AST {
         AddChild(node);
     }
 
-    std::string getName() override {
-        return id;
+    void printNode() override {
+        std::cout << std::string(INDENTS*2, INDENT_CHAR);
+        std::cout << "--Function Invocation {'name': " << getName() << ", 'lineno': " << lineno << "}" << "\n";
     }
+};
 
-    void reverseChildren() override {
-        std::reverse(children.begin(), children.end());
-        for (auto child : children) {   
-            child->reverseChildren();
+void ChildList::push_back(AST *child) {
+    if (count == capacity) {
+        capacity = capacity == 0 ? 2 : 2 * capacity;
+        AST **grown = static_cast<AST**>(AST::arena->allocate(capacity * sizeof(AST*), alignof(AST*)));
+        if (count > 0) {
+            memcpy(grown, items, count * sizeof(AST*));
         }
+        items = grown;
     }
+    items[count++] = child;
+}
 
-    void Print() override {
-        std::cout << std::string(INDENTS*2, INDENT_CHAR);
-        std::cout << "--Function Invocation {'name': " << id << ", 'lineno': " << lineno << "}" << "\n";
-        INDENTS++;
-        for (auto child : children)
-        {
-            child->Print();
-        }
-        INDENTS--;
-    }
-};
+// The arena frees nodes without running destructors
+static_assert(std::is_trivially_destructible<Prog>::value && std::is_trivially_destructible<Block>::value &&
+              std::is_trivially_destructible<String>::value && std::is_trivially_destructible<FuncDecl>::value,
+              "AST nodes must not own memory outside the arena");
 #endif
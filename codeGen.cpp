@@ -5,493 +5,765 @@
 #include <fstream>
 #include "vector"
 #include <unordered_map>
-#include <stack> 
+#include <unordered_set>
+#include <stack>
 #include <memory>
 using namespace std;
 #include "ast.hpp"
+#include "asmWriter.hpp"
+#include "inliner.hpp"
+#include "ir.hpp"
+#include "isel.hpp"
+#include "mips.hpp"
+#include "peephole.hpp"
+#include "regAlloc.hpp"
 #include "semAnalyzer.cpp"
 
 //Data Structures
-string dataSec, mainSec, funcSec;
-int labelNum = 0, whileLabelNum = -1, currentRegister = 0;
-unordered_map<string, entry> currSymTable;
-vector<string> funcNames, variableStack;
-bool inMain = false;
+AsmWriter asmWriter;
+RegisterAllocator regAllocator;
+PeepholeOptimizer peephole;
+bool usePeephole = true;    // Whether to run the peephole optimizer, cleared by --no-peephole
+int labelNum = 0;
+InstructionSelector selector(asmWriter.data, labelNum);
+bool writeIr = false;       // Whether to write the IR of every function to the .ir file
+Inliner inliner;
+bool useInliner = true;     // Whether to inline calls, cleared by --no-inline
 extern char* filename;
 
-//Function
-string createAssemblyCode(AST * root);
-string writeTest(AST * node, int localLabelNum);
-string getIntOrBool(AST* node);
-string getOffset(string input);
-string loadRegister(AST* node, int resultRegister);
+// IR of the function being built, and the block its code goes to
+IrFunction ir;
+int currentBlock = 0;
+bool blockEnded = false;    // Whether the current block has its terminator
+vector<int> loopExits;      // Blocks after the loops around the current statement
 
-void generateCode(AST * root) {
-    string fname = string(filename);
-    fname.append(".asm");
-    ofstream file(fname);
-    dataSec = "\t.globl main\n\t.data\n";
-    root->Print();
+// IR of every function of the program, in the order they are declared
+vector<IrFunction> functions;
 
-    for (AST* child : root->getChildren()) {
-        createAssemblyCode(child);
-    }
+// MIPS code of the function, in virtual registers until it is allocated
+vector<Instr> code;
 
-    string stackAlloc = "\n\t.text\nmain:\nsub $sp, $sp, " + to_string(4*variableStack.size()).append("\n");
-    mainSec = stackAlloc + mainSec;
+// Locals and parameters of the function that some operand assigns, so a read of
+// one can be changed by a later operand of the same expression
+unordered_set<entry*> assignedInOperands;
 
-    mainSec.append("end:\n");
-    mainSec.append("li $v0, 10\n");
-    mainSec.append("syscall\n"); 
+/*
+Values holding the global variables last loaded or stored in the current
+block, by their symbol table entry. Reading a global again takes the value
+instead of another load, and assignments still store right away, so memory
+always has the value for the functions called. A new block or a call of a
+function of the program forgets them all. Only a few are kept, since each one
+ties up a register for as long as it is remembered.
+*/
+class GlobalCache
+{
+    private:
+    static const size_t SIZE = 6;
 
-    file << dataSec;
-    file << mainSec;
-    file << funcSec;
-    file.close();
+    vector<pair<entry*, Value>> entries;    // Most recently used last
 
-}
-
-string createAssemblyCode(AST * node) {
-    string temp = node->getNodeType();
-    string output;
-    if (temp == "maindecl") {
-        inMain = true; 
-        for (AST* child : node->getChildren()) {
-            output.append(createAssemblyCode(child));
-
-        }   
-        mainSec.append(output);        
-        inMain = false;
-    }
-    else if (temp == "funcdecl") {
-        funcSec.append(node->getName()).append(":\n");
-        int currParam = 0;
-        for (AST* child : node->getChildren()) {
-            if (child->getNodeType() == "param") {
-                output.append("sub $sp, $sp, 4\n");
-                output.append("sw $a").append(to_string(currParam)).append(", 0($sp)\n");
-                variableStack.push_back(child->getName());
-                currParam++;
-            }
-            else {
-                output.append(createAssemblyCode(child));
+    public:
+    Value find(entry* variable) {
+        for (size_t i = entries.size(); i-- > 0; ) {
+            if (entries[i].first == variable) {
+                pair<entry*, Value> entry = entries[i];
+                entries.erase(entries.begin() + i);
+                entries.push_back(entry);
+                return entry.second;
             }
-
-        }  
-        if (currParam != 0) {     
-            output.append("add $sp, $sp, ").append(to_string(4*currParam)).append("\n");
         }
-        for (int i = 0; i < currParam; i++) {
-            variableStack.pop_back();
-        }
-        output.append("jr $ra\n");
-        funcSec.append(output);  
+        return NO_VALUE;
     }
 
-    else if (temp == "vardecl") {
-        variableStack.push_back(node->getName());
-    }
-
-    else if (temp == "assnstmt") {
-        string type = node->getChildren().at(1)->getNodeType();
-        if (type == "funccall") {
-            output.append(createAssemblyCode(node->getChildren().at(1)));
-            output.append("move $t").append(to_string(currentRegister)).append(", $v0\n");            
-        }
-        else if (type == "id") {
-            output.append(loadRegister(node->getChildren().at(1), currentRegister));
-        }
-        else if ((type == "literal") || (type == "num")) {
-            output.append("li $t").append(to_string(currentRegister)).append(", ").append(getIntOrBool(node->getChildren().at(1))).append("\n");
-        }
-        else {
-            output.append(createAssemblyCode(node->getChildren().at(1)));
-        }
-        output.append("sw $t").append(to_string(currentRegister)).append(", ").append(getOffset(node->getName())).append("($sp)\n");
-    }
-
-    else if (temp == "id") {
-        // Return the offset of the id in the stack
-        output.append(getOffset(node->getName()));
-    }
-
-    // Place params into the subroutine registers, then jump and link to the function given
-    else if (temp == "funccall") {
-        bool funcFound = false;
-        auto it = symTables[5].begin();
-        for (int i = 0; i < symTables[5].size(); i++) {
-            if (it->first == node->getName()) {
-                funcFound = true;
-                for (auto& it2 : *it->second.symTable) {
-                    if ((1 <= it2.second.paramNum) && (4 >= it2.second.paramNum)) {
-                        string type = node->getChildren().at(it2.second.paramNum - 1)->getNodeType();
-                        string value;
-                        AST* child = node->getChildren().at(it2.second.paramNum - 1);
-                        if ((type == "num") || (type == "literal")) {
-                            value = getIntOrBool(child);
-                            output.append("li $a").append(to_string(it2.second.paramNum - 1)).append(", ").append(value);
-                        }        
-                        else if (type == "id") {
-                            output.append("lw $a").append(to_string(it2.second.paramNum - 1)).append(", ").append(getOffset(child->getName())).append("($sp)\n");
-                        }    
-                        else if (type == "funccall") {
-                            output.append(createAssemblyCode(child));
-                            output.append("move $a").append(to_string(it2.second.paramNum - 1)).append(", $v0").append("\n");                            
-                        }   
-                        else {
-                            output.append(createAssemblyCode(child));
-                            output.append("move $a").append(to_string(it2.second.paramNum - 1)).append(", $t").append(to_string(currentRegister)).append("\n");
-                        }
-                    } 
-                    else if (it2.second.paramNum != 0) {
-                        string value;
-                        string type = node->getChildren().at(it2.second.paramNum - 1)->getNodeType();
-                        if (type == "num") {
-                            value = node->getChildren().at(it2.second.paramNum - 1)->getValue();
-                        } 
-                        else if (type == "literal") {
-                            if (node->getChildren().at(it2.second.paramNum - 1)->getValue() == "true") {
-                                value = "1";
-                            } else {
-                                value = "0";
-                            }
-                        }
-                        
-                        output.append("li $t").append(to_string(it2.second.paramNum - 5)).append(", ").append(value).append("\n");                        
-                    }
-                }
-                output.append("jal ").append(node->getName()).append("\n");
+    void forget(entry* variable) {
+        for (size_t i = 0; i < entries.size(); i++) {
+            if (entries[i].first == variable) {
+                entries.erase(entries.begin() + i);
                 break;
             }
-            it++;
-        }
-        if (!funcFound) {
-            string name = node->getName();
-            if (name == "halt") {
-                output.append("j end\n");
-            }
-            else if (name == "getchar") {
-                dataSec.append("label").append(to_string(labelNum)).append(": .asciiz \"Enter an int now:\"\n");
-                output.append("li $v0, 4\nla $a0, label").append(to_string(labelNum)).append("\nsyscall\n");
-                output.append("li $v0, 5\nsyscall\n");
-
-                labelNum++;
-            }
-            else {
-                string strOutput;
-                if (name == "printb") {
-                    dataSec.append("label").append(to_string(labelNum)).append(": .asciiz \"true\"\n");                    
-                    dataSec.append("label").append(to_string(labelNum+1)).append(": .asciiz \"false\"\n");
-                    output.append("li $v0, 4\n");
-                    if (node->getChildren().at(0)->getNodeType() == "literal") {
-                        strOutput = getIntOrBool(node->getChildren().at(0));  
-                        output.append("li $a0, ").append(strOutput).append("\n");       
-                    }
-                    else if (node->getChildren().at(0)->getNodeType() == "id") {
-                        output.append("lw $a0, ").append(getOffset(node->getChildren().at(0)->getName())).append("($sp)\n");
-                    }       
-                    //Print out the branching if else statement for the printb function
-                    output.append("beq $0, $a0, label").append(to_string(labelNum+2)).append("\n");
-                    output.append("la $a0, label").append(to_string(labelNum)).append("\nsyscall\nb label").append(to_string(labelNum+3)).append("\n");
-                    output.append("label").append(to_string(labelNum+2)).append(":\n");
-                    output.append("la $a0, label").append(to_string(labelNum+1)).append("\nsyscall\n");
-                    output.append("label").append(to_string(labelNum+3)).append(":\n");    
-                    labelNum+=4;                    
-                }
-                else if (name == "printc") {
-                    char arr[strOutput.size()];
-                    for (int i = 0; i < strOutput.size(); i++) {
-                        arr[i] = (int)strOutput.at(i);
-                    }
-                    dataSec.append("label").append(to_string(labelNum)).append(": .asciiz \"").append(arr).append("\"\n");
-                    output.append("li $v0, 4\nla $a0, label").append(to_string(labelNum)).append("\nsyscall\n");
-                    labelNum++;    
-                }
-                else if (name == "printi") {
-                    strOutput = getIntOrBool(node->getChildren().at(0));
-                    if (strOutput == "error") {
-                        output.append(createAssemblyCode(node->getChildren().at(0)));
-                        output.append("move $a0, $v0\nli $v0, 1\n").append("\nsyscall\n");
-                    }
-                    else if (strOutput == "id") {
-                        output.append("li $v0, 1\nlw $a0, ").append(getOffset(node->getChildren().at(0)->getName())).append("($sp)\n").append("syscall\n");
-                    } 
-                    else {
-                        output.append("li $v0, 1\nli $a0, ").append(strOutput).append("\nsyscall\n");
-                    }                                
-                }
-                else if (name == "prints") {
-                    strOutput = node->getChildren().at(0)->getValue();
-                    dataSec.append("label").append(to_string(labelNum)).append(": .asciiz ").append(strOutput).append("\n");
-                    output.append("li $v0, 4\nla $a0, label").append(to_string(labelNum)).append("\nsyscall\n");
-                    labelNum++;  
-                }
-            }
         }
     }
 
-    else if (temp == "if") {
-        bool elseStmt = false;
-        int localLabelNum = labelNum;
-        labelNum++;
-        for (AST* child : node->getChildren()) {
-            if (child->getNodeType() == "else") {
-                elseStmt = true;
-                break;
-            }
+    void set(entry* variable, Value value) {
+        forget(variable);
+        if (entries.size() == SIZE) {
+            entries.erase(entries.begin());
         }
-        if (!elseStmt) {
-            temp = writeTest(node->getChildren().at(0), localLabelNum);
-            output.append(temp);
-            for (int i = 1; i < node->getChildren().size(); i++) {
-                createAssemblyCode(node->getChildren().at(i));
-            }      
-            output.append("label").append(to_string(localLabelNum)).append(":\n");
+        entries.push_back({variable, value});
+    }
 
-        }
-        else {
-            temp = writeTest(node->getChildren().at(0), localLabelNum);
-            output.append(temp);
-            // Skip over the first child to not write the test again for 
-            // the if statement
-            for (int i = 1; i < node->getChildren().size(); i++) {
-                AST * child = node->getChildren().at(i);
-                if (child->getNodeType() != "else") {
-                    createAssemblyCode(child);
-                }
-            }
-            int labelAfter = labelNum;
-            labelNum++;
-            output.append("b label").append(to_string(labelAfter)).append("\n");            
-            output.append("label").append(to_string(localLabelNum)).append(":\n");
-            for (AST* child : node->getChildren()) {
-                if (child->getNodeType() == "else") {
-                    createAssemblyCode(child);
-                }
+    bool holds(Value value) const {
+        for (const pair<entry*, Value>& entry : entries) {
+            if (entry.second == value) {
+                return true;
             }
-            output.append("label").append(to_string(labelAfter)).append(":\n");            
-            labelNum++;
         }
+        return false;
     }
-    else if (temp == "else") {
-        for (AST* child : node->getChildren()) {
-            output.append(createAssemblyCode(child));
-        }        
+
+    void clear() {
+        entries.clear();
     }
+};
 
-    else if (temp == "break") {
-        output.append("b label").append(to_string(whileLabelNum)).append("\n");
+GlobalCache globalCache;
+
+//Function
+void buildFunction(AST * root);
+static void finishFunction(Chunks& out);
+
+void generateCode(AST * root) {
+    string fname = string(filename);
+    ofstream file(fname + ".asm");
+    ofstream irFile;
+    if (writeIr) {
+        irFile.open(fname + ".ir");
     }
-    else if (temp == "return") {
-        if (inMain) {
-            output.append("j end\n");
-        }
-        else {
-            if (node->getChildren().size() > 0) {
-                AST *child = node->getChildren().at(0);
-                string childType = child->getNodeType();
-                if ((childType == "num") || childType == "literal") {
-                    output.append("li $v0, ").append(getIntOrBool(child)).append("\n");
-                }
-                else if (childType == "id") {
-                    output.append("lw $v0, ").append(getOffset(child->getName())).append("($sp)\n");
-                }
-                else {
-                    output.append(createAssemblyCode(child));
-                }
-            }
-            output.append("jr $ra\n");
+    asmWriter.begin(file);
+
+    // Every function is built into IR first, so calls can be inlined between
+    // them, then each is lowered to MIPS and allocated before the next
+    functions.clear();
+    for (AST* child : root->getChildren()) {
+        if (child->getKind() == NodeKind::VAR_DECL) {
+            selector.globalLabel(child->getDecl());
+            continue;
         }
+        buildFunction(child);
+        functions.push_back(std::move(ir));
     }
-    else if (temp == "while") {
-        int firstLabel = labelNum;
-        labelNum++;
-        int secondLabel = labelNum;
-        if (whileLabelNum == -1) {
-            whileLabelNum = secondLabel;
-        }
-        labelNum++; 
-        output.append("label").append(to_string(firstLabel)).append(":\n");
-        temp = writeTest(node->getChildren().at(0), secondLabel);
-        output.append(temp);
-        for (int i = 1; i < node->getChildren().size(); i++) {
-            output.append(createAssemblyCode(node->getChildren().at(i)));
-        }        
-        output.append("b label").append(to_string(firstLabel)).append("\n");
-        output.append("label").append(to_string(secondLabel)).append(":\n");
-        if (whileLabelNum == secondLabel) {
-            whileLabelNum = -1;
-        }
+    if (useInliner) {
+        inliner.run(functions);
     }
-    else if (temp == "arithmetic") {
-        int resultRegister = currentRegister;
-        bool singleNegative = false;
-        AST* leftChild = node->getChildren().at(0);
-        // If there's only one child, then that child must be the right side of a '-' operation
-        AST* rightChild;
-        if (node->getChildren().size() > 1) {
-            rightChild = node->getChildren().at(1);
-        }
-        output.append(loadRegister(leftChild, resultRegister+1));
-        if (rightChild == NULL) {
-            singleNegative = true;
-        } 
-        else {
-            output.append(loadRegister(rightChild, resultRegister+2));            
+    for (size_t i = 0; i < functions.size(); i++) {
+        if (inliner.isRemoved(i)) {
+            continue;
         }
-        //Write to the text section for the correct arithmetic operation
-        if (node->getType() == "+") {
-            output.append("add $t").append(to_string(resultRegister)).append(", $t").append(to_string(resultRegister+1)).append(", $t").append(to_string(resultRegister+2)).append("\n");
+        ir = std::move(functions[i]);
+        if (writeIr) {
+            dumpIr(irFile, ir);
         }
-        else if (node->getType() == "-") {
-            if (singleNegative) {
-            output.append("neg $t").append(to_string(resultRegister)).append(", $t").append(to_string(resultRegister+1)).append("\n");
-            }
-            else {
-            output.append("sub $t").append(to_string(resultRegister)).append(", $t").append(to_string(resultRegister+1)).append(", $t").append(to_string(resultRegister+2)).append("\n");                
-            }
-        }
-        else if (node->getType() == "*") {
-            output.append("mul $t").append(to_string(resultRegister)).append(", $t").append(to_string(resultRegister+1)).append(", $t").append(to_string(resultRegister+2)).append("\n");
-        }
-        else if (node->getType() == "/") {
-            output.append("div $t").append(to_string(resultRegister)).append(", $t").append(to_string(resultRegister+1)).append(", $t").append(to_string(resultRegister+2)).append("\n");
+        if (ir.isMain) {
+            finishFunction(asmWriter.main);
         }
-        else if (node->getType() == "%") {
-            output.append("rem $t").append(to_string(resultRegister)).append(", $t").append(to_string(resultRegister+1)).append(", $t").append(to_string(resultRegister+2)).append("\n");
+        else {
+            asmWriter.text.append(interner.name(ir.name).str()).append(":\n");
+            finishFunction(asmWriter.text);
+            asmWriter.endFunction();
         }
-        currentRegister = resultRegister;
     }
-    else if (temp == "compare") {
-        int resultRegister = currentRegister;
-        AST* leftChild = node->getChildren().at(0);
-        AST* rightChild = node->getChildren().at(1);
+    functions.clear();
 
-        output.append(loadRegister(leftChild, resultRegister+1));
-        output.append(loadRegister(rightChild, resultRegister+2));
+    asmWriter.main.append("end:\n");
+    asmWriter.main.append("li $v0, 10\n");
+    asmWriter.main.append("syscall\n");
 
-        if (node->getType() == "==") {
-            output.append("seq $t").append(to_string(resultRegister)).append(", $t").append(to_string(resultRegister+1)).append(", $t").append(to_string(resultRegister+2)).append("\n");
-        }
-        if (node->getType() == "!=") {
-            output.append("sne $t").append(to_string(resultRegister)).append(", $t").append(to_string(resultRegister+1)).append(", $t").append(to_string(resultRegister+2)).append("\n");
-        }        
-        else if (node->getType() == ">=") {
-            output.append("sge $t").append(to_string(resultRegister)).append(", $t").append(to_string(resultRegister+1)).append(", $t").append(to_string(resultRegister+2)).append("\n");
-        }
-        else if (node->getType() == "<=") {
-            output.append("sle $t").append(to_string(resultRegister)).append(", $t").append(to_string(resultRegister+1)).append(", $t").append(to_string(resultRegister+2)).append("\n");            
-        }
-        else if (node->getType() == ">") {
-            output.append("sgt $t").append(to_string(resultRegister)).append(", $t").append(to_string(resultRegister+1)).append(", $t").append(to_string(resultRegister+2)).append("\n");            
-        }
-        else if (node->getType() == "<") {
-            output.append("slt $t").append(to_string(resultRegister)).append(", $t").append(to_string(resultRegister+1)).append(", $t").append(to_string(resultRegister+2)).append("\n");            
-        }
-        currentRegister = resultRegister;
+    asmWriter.finish("main:\n");
+    file.close();
+
+}
+
+// Selects the instructions of the function built, allocates their registers and
+// appends the code to out. The peephole optimizer runs on both sides of the
+// allocation, the second time for the spill code and the copies it leaves.
+static void finishFunction(Chunks& out) {
+    Reg lastReg = selector.select(ir, code);
+    if (usePeephole) {
+        peephole.run(code, ir.variables);
     }
-    else if (temp == "logical") {
-        bool notOper = false;
-        int resultRegister = currentRegister;
-        AST* leftChild = node->getChildren().at(0);
-        AST* rightChild;
-        if ((node->getChildren().size()) > 1) {
-            rightChild = node->getChildren().at(1);
-        } else {
-            notOper = true;
-        }
+    regAllocator.allocate(code, lastReg, !ir.isMain);
+    if (usePeephole) {
+        peephole.run(code, ir.variables);
+    }
+    static string lines;
+    lines.clear();
+    for (const Instr& in : code) {
+        writeInstr(lines, in);
+    }
+    out.append(lines);
+}
 
-        output.append(loadRegister(leftChild, resultRegister+1));
-        if (!notOper) {
-            output.append(loadRegister(rightChild, resultRegister+2));
-        }
+// IR building state of one node. buildFunction keeps these on an explicit stack
+// instead of recursing, so deeply nested statements and expressions only cost
+// heap memory proportional to their depth.
+struct CodeFrame {
+    AST* node;
+    int state = 0;      // Where to resume when the child being built returns
+    int i = 0;          // Next child to build
+    int a = 0, b = 0;   // Blocks that must survive the children
+    bool condition = false;     // Whether the node is a test, see buildFunction
+    bool elseStmt = false;
+    bool userFunction = false;  // Whether a call is to a function declared in the program
+    size_t values;      // Size of the value stack when the node was entered
 
-        if (node->getType() == "&&") {
-            output.append("and $t").append(to_string(resultRegister)).append(", $t").append(to_string(resultRegister+1)).append(", $t").append(to_string(resultRegister+2)).append("\n");
-        }
-        else if (node->getType() == "||") {
-            output.append("or $t").append(to_string(resultRegister)).append(", $t").append(to_string(resultRegister+1)).append(", $t").append(to_string(resultRegister+2)).append("\n");
-        }
-        else if (node->getType() == "!") {
-            output.append("not $t").append(to_string(resultRegister)).append(", $t").append(to_string(resultRegister+1)).append("\n");     
-        }       
-        currentRegister = resultRegister;
+    CodeFrame(AST* n, size_t v) : node(n), values(v) {}
+};
+
+// Gives a local or parameter the value it lives in for the whole function
+static void declareLocal(AST* node) {
+    node->getDecl()->location = ir.newValue(node->getDecl()->type, true);
+}
+
+// Continues the code in block, which the current block falls into unless it has ended
+static void startBlock(int block) {
+    if (!blockEnded) {
+        ir.code.push_back({.op = IrOp::JUMP, .target = block});
+    }
+    ir.blocks[currentBlock].end = ir.code.size();
+    ir.blocks[block].begin = ir.code.size();
+    ir.layout.push_back(block);
+    currentBlock = block;
+    blockEnded = false;
+    globalCache.clear();
+}
+
+static void emit(const IrInstr& in) {
+    // Code after a return, break or halt() goes to a block nothing jumps to
+    if (blockEnded) {
+        startBlock(ir.newBlock());
     }
+    ir.code.push_back(in);
+    blockEnded = isTerminator(in.op);
+}
+
+static Value newTemp(Type type) {
+    return ir.newValue(type, false);
+}
 
-    else if (temp == "block") {
+// Finds the locals assigned by an assignment that is an operand, in a walk of the
+// function on an explicit stack
+static void findOperandAssignments(AST* function) {
+    assignedInOperands.clear();
+    static vector<AST*> work;
+    work.assign(1, function);
+    while (!work.empty()) {
+        AST* node = work.back();
+        work.pop_back();
+        NodeKind kind = node->getKind();
+        bool operands = kind == NodeKind::ARITHMETIC || kind == NodeKind::COMPARE || kind == NodeKind::LOGICAL
+                        || kind == NodeKind::FUNC_CALL || kind == NodeKind::ASSN_STMT;
         for (AST* child : node->getChildren()) {
-            output.append(createAssemblyCode(child));
+            if (operands && child->getKind() == NodeKind::ASSN_STMT && child->getDecl()->scope != 1) {
+                assignedInOperands.insert(child->getDecl());
+            }
+            work.push_back(child);
         }
     }
-    return output;
 }
 
-string writeTest(AST* node, int localLabelNum) {
-    string output;
-    if (node->getNodeType() == "literal") {
-        if (node->getValue() == "true") {
-            output.append("li $t0, 1\nbeq $0, $t0, label").append(to_string(localLabelNum)).append("\n");
-        }
-        else {
-            output.append("li $t0, 0\nbeq $0, $t0, label").append(to_string(localLabelNum)).append("\n");
-        }
+static void startFunction(AST* node) {
+    ir.clear();
+    ir.isMain = node->getKind() == NodeKind::MAIN_DECL;
+    ir.name = node->getSymbol();
+    ir.returnType = node->getDecl()->signature->returnType;
+    currentBlock = ir.newBlock();
+    ir.blocks[currentBlock].begin = 0;
+    ir.layout.push_back(currentBlock);
+    blockEnded = false;
+    loopExits.clear();
+    globalCache.clear();
+    findOperandAssignments(node);
+}
+
+static void endFunction() {
+    if (!blockEnded) {
+        emit({.op = IrOp::RET});
     }
-    else if (node->getNodeType() == "compare") {
-        int outputRegister = currentRegister;
-        output.append(createAssemblyCode(node));
-        output.append("beq $0, $t").append(to_string(outputRegister)).append(", label").append(to_string(localLabelNum)).append("\n");        
+    ir.blocks[currentBlock].end = ir.code.size();
+}
+
+// Returns the value of the variable an identifier was resolved to, loading a
+// global unless a value has it already
+static Value loadVariable(AST* node) {
+    entry* variable = node->getDecl();
+    if (variable->scope != 1) {
+        return variable->location;
     }
-    else if (node->getNodeType() == "logical") {
-        int outputRegister = currentRegister;
-        output.append(createAssemblyCode(node));
-        output.append("beq $0, $t").append(to_string(outputRegister)).append(", label").append(to_string(localLabelNum)).append("\n");               
+    Value value = globalCache.find(variable);
+    if (value == NO_VALUE) {
+        value = newTemp(variable->type);
+        emit({.op = IrOp::LOAD, .dst = value, .name = node->getSymbol(), .variable = variable});
+        globalCache.set(variable, value);
     }
-    return output;
+    return value;
 }
 
-string getIntOrBool(AST* node) {
-    string output;
-    if (node->getValue() == "true") {
-        return "1";
-    }
-    else if (node->getValue() == "false") {
-        return "0";
+// Sets a local to a value, computing the value straight into it when it was just
+// computed into a temporary nothing else reads
+static void assign(Value local, Value value) {
+    if (!blockEnded && !ir.code.empty() && ir.code.back().dst == value && !ir.variables[value] && !globalCache.holds(value)) {
+        ir.code.back().dst = local;
     }
-    else if (node->getType() == "int") {
-        return node->getValue();
-    }   
-    else if (node->getNodeType() == "id") {
-        return "id";
+    else {
+        emit({.op = IrOp::COPY, .dst = local, .a = value});
     }
-    return "error";
 }
 
-string getOffset(string input) {
-    for (int i = 0; i < variableStack.size(); i++) {
-        if (variableStack.at(i) == input) {
-            return to_string(4 * (variableStack.size() - (i+1)));
-        }
+// Assigns a value to the variable of an assignment, and returns the value the
+// assignment has as an expression
+static Value storeVariable(AST* node, Value value) {
+    entry* variable = node->getDecl();
+    if (variable->scope != 1) {
+        assign(variable->location, value);
+        return variable->location;
+    }
+    emit({.op = IrOp::STORE, .a = value, .name = node->getSymbol(), .variable = variable});
+    // The value of a local changes with the local
+    if (ir.variables[value]) {
+        globalCache.forget(variable);
     }
-    return "";
+    else {
+        globalCache.set(variable, value);
+    }
+    return value;
 }
 
-string loadRegister(AST* node, int resultRegister) {
-    string output;
-    if (node->getType() == "int") {
-            output.append("li $t").append(to_string(resultRegister)).append(", ").append(node->getValue()).append("\n");
-        }
-    else if (node->getValue() == "true") {
-            output.append("li $t").append(to_string(resultRegister)).append(", 1\n");
+// Whether the value of an assignment is used, by the node of the frame under it,
+// rather than the assignment being a statement of its own
+static bool valueUsed(const CodeFrame& parent) {
+    if (parent.condition) {
+        return true;
     }
-    else if (node->getValue() == "false") {
-            output.append("li $t").append(to_string(resultRegister)).append(", 0\n");
+    switch (parent.node->getKind()) {
+    case NodeKind::MAIN_DECL:
+    case NodeKind::FUNC_DECL:
+    case NodeKind::BLOCK:
+    case NodeKind::ELSE_STMT:
+    case NodeKind::IF_STMT:
+    case NodeKind::WHILE_STMT:
+        return false;
+    default:
+        return true;
     }
-    else if (node->getNodeType() == "id") {
-        output.append("lw $t").append(to_string(resultRegister)).append(", ").append(getOffset(node->getName())).append("($sp)\n");
+}
+
+// Whether an expression can be evaluated where it wouldn't run, because it has
+// no effect and can't trap. Deep expressions are assumed not to be.
+static bool isPure(AST* node, int depth = 0) {
+    switch (node->getKind()) {
+    case NodeKind::ID:
+    case NodeKind::NUM:
+    case NodeKind::LITERAL:
+        return true;
+    case NodeKind::COMPARE:
+    case NodeKind::LOGICAL:
+        if (depth == 4) {
+            return false;
+        }
+        for (AST* child : node->getChildren()) {
+            if (!isPure(child, depth + 1)) {
+                return false;
+            }
+        }
+        return true;
+    default:
+        return false;
     }
-    else {
-        currentRegister++;
-        output.append(createAssemblyCode(node));
+}
+
+static IrOp operatorOp(AST* node) {
+    string oper = node->getType();
+    if (oper == "+") return IrOp::ADD;
+    if (oper == "-") return node->numChildren() == 1 ? IrOp::NEG : IrOp::SUB;
+    if (oper == "*") return IrOp::MUL;
+    if (oper == "/") return IrOp::DIV;
+    if (oper == "%") return IrOp::REM;
+    if (oper == "==") return IrOp::EQ;
+    if (oper == "!=") return IrOp::NE;
+    if (oper == ">=") return IrOp::GE;
+    if (oper == "<=") return IrOp::LE;
+    if (oper == ">") return IrOp::GT;
+    if (oper == "<") return IrOp::LT;
+    if (oper == "&&") return IrOp::AND;
+    if (oper == "||") return IrOp::OR;
+    return IrOp::NOT;
+}
+
+// Builds the IR of main or of a function into ir
+void buildFunction(AST * root) {
+    // Each expression leaves the value it computes on the value stack, where its
+    // parent picks it up. The test of an if or while is built as a condition
+    // instead, which jumps to block a of its frame when it is true and to block b
+    // when it is false, so no boolean is made for it. The left operand of && and
+    // || then jumps past the right one when it decides the result.
+    static vector<CodeFrame> frames;
+    static vector<Value> values;
+    values.clear();
+    frames.emplace_back(root, 0);
+
+    // Suspends the frame on top of the stack until the IR for child is built
+    auto call = [](AST* child, int resume) {
+        frames.back().state = resume;
+        frames.emplace_back(child, values.size());
+    };
+    auto pop = []() {
+        Value value = values.back();
+        values.pop_back();
+        return value;
+    };
+    // Suspends the frame on top of the stack until the condition child is built
+    auto test = [](AST* child, int resume, int ifTrue, int ifFalse) {
+        frames.back().state = resume;
+        frames.emplace_back(child, values.size());
+        frames.back().condition = true;
+        frames.back().a = ifTrue;
+        frames.back().b = ifFalse;
+    };
+    // Builds the next part of a condition, and returns whether it is complete.
+    // && and || test their right operand in block i.
+    auto condition = [&call, &pop, &test](CodeFrame& f) {
+        AST* node = f.node;
+        string oper = node->getKind() == NodeKind::LOGICAL ? node->getType() : "";
+        if (oper == "!") {
+            if (f.state == 0) {
+                test(node->getChild(0), 1, f.b, f.a);
+                return false;
+            }
+        }
+        else if (oper == "&&" || oper == "||") {
+            if (f.state == 0) {
+                f.i = ir.newBlock();
+                if (oper == "&&") {
+                    test(node->getChild(0), 1, f.i, f.b);
+                }
+                else {
+                    test(node->getChild(0), 1, f.a, f.i);
+                }
+                return false;
+            }
+            if (f.state == 1) {
+                startBlock(f.i);
+                test(node->getChild(1), 2, f.a, f.b);
+                return false;
+            }
+        }
+        else if (node->getKind() == NodeKind::LITERAL) {
+            emit({.op = IrOp::JUMP, .target = node->getValue() == "true" ? f.a : f.b});
+        }
+        else if (f.state == 0) {
+            call(node, 1);
+            return false;
+        }
+        else {
+            emit({.op = IrOp::BRANCH, .a = pop(), .target = f.a, .elseTarget = f.b});
+        }
+        return true;
+    };
+
+    while (true) {
+        CodeFrame& f = frames.back();
+        if (f.condition) {
+            // A condition always has the if, while or condition it belongs to under it
+            if (condition(f)) {
+                frames.pop_back();
+            }
+            continue;
+        }
+        AST* node = f.node;
+        int numChildren = node->numChildren();
+        bool done = false;
+        switch (node->getKind()) {
+        case NodeKind::MAIN_DECL:
+        case NodeKind::FUNC_DECL: {
+            // The parameters are the first values, in order
+            if (f.state == 0) {
+                startFunction(node);
+                while (f.i < numChildren && node->getChild(f.i)->getKind() == NodeKind::PARAM) {
+                    declareLocal(node->getChild(f.i++));
+                    ir.numParams++;
+                }
+            }
+            values.resize(f.values);
+            if (f.i < numChildren) {
+                call(node->getChild(f.i++), 1);
+                break;
+            }
+            endFunction();
+            done = true;
+            break;
+        }
+        case NodeKind::VAR_DECL: {
+            if (node->getDecl()->scope == 1) {
+                selector.globalLabel(node->getDecl());
+            }
+            else {
+                declareLocal(node);
+            }
+            done = true;
+            break;
+        }
+        case NodeKind::ASSN_STMT: {
+            if (f.state == 0) {
+                call(node->getChild(1), 1);
+                break;
+            }
+            Value value = storeVariable(node, pop());
+            // Used as an operand, the assignment gives the value assigned, which a
+            // later assignment to the local in the same expression must not change
+            if (ir.variables[value] && valueUsed(frames[frames.size() - 2])) {
+                Value assigned = newTemp(ir.types[value]);
+                emit({.op = IrOp::COPY, .dst = assigned, .a = value});
+                value = assigned;
+            }
+            values.push_back(value);
+            done = true;
+            break;
+        }
+        case NodeKind::ID: {
+            Value value = loadVariable(node);
+            // Read the local now, a later operand may assign it before the value is used
+            if (assignedInOperands.count(node->getDecl()) > 0) {
+                Value read = newTemp(ir.types[value]);
+                emit({.op = IrOp::COPY, .dst = read, .a = value});
+                value = read;
+            }
+            values.push_back(value);
+            done = true;
+            break;
+        }
+        case NodeKind::NUM:
+        case NodeKind::LITERAL: {
+            bool literal = node->getKind() == NodeKind::LITERAL;
+            Value value = newTemp(literal ? Type::BOOLEAN : Type::INT);
+            int constant = literal ? node->getValue() == "true" : stoi(node->getValue());
+            emit({.op = IrOp::CONST, .dst = value, .imm = constant});
+            values.push_back(value);
+            done = true;
+            break;
+        }
+        case NodeKind::FUNC_CALL: {
+            // i counts the arguments still to build. They are evaluated last to
+            // first, the order they used to come out of the function's hash table in.
+            Symbol name = node->getSymbol();
+            if (f.state == 0) {
+                entry* callee = node->getDecl();
+                if (callee->scope == 1) {
+                    f.userFunction = true;
+                    f.i = callee->signature != nullptr ? callee->signature->params.size() : 0;
+                }
+                else if (name == SYM_PRINTB || name == SYM_PRINTI) {
+                    f.i = 1;
+                }
+                f.state = 1;
+            }
+            if (f.i > 0) {
+                call(node->getChild(--f.i), 1);
+                break;
+            }
+            if (name == SYM_HALT) {
+                emit({.op = IrOp::HALT});
+                values.push_back(NO_VALUE);
+                done = true;
+                break;
+            }
+            // The value of argument k is at f.values + numArgs - 1 - k
+            int numArgs = values.size() - f.values;
+            IrInstr in = {.op = IrOp::CALL, .imm = (int)ir.args.size(), .count = numArgs, .name = name};
+            for (int k = 0; k < numArgs; k++) {
+                ir.args.push_back(values[f.values + numArgs - 1 - k]);
+            }
+            values.resize(f.values);
+            const Signature* signature = node->getDecl()->signature;
+            if (signature != nullptr && signature->returnType != Type::VOID) {
+                in.dst = newTemp(signature->returnType);
+            }
+            if (name == SYM_PRINTS) {
+                in.imm = ir.strings.size();
+                ir.strings.push_back(node->getChild(0)->getValue());
+            }
+            emit(in);
+            // The function may assign any global
+            if (f.userFunction) {
+                globalCache.clear();
+            }
+            values.push_back(in.dst);
+            done = true;
+            break;
+        }
+        case NodeKind::IF_STMT: {
+            // a is the block of the else part, b the block after the if statement.
+            // i is the block of the then part while the test is built.
+            if (f.state == 0) {
+                for (int i = 0; i < numChildren; i++) {
+                    if (node->getChild(i)->getKind() == NodeKind::ELSE_STMT) {
+                        f.elseStmt = true;
+                        break;
+                    }
+                }
+                f.i = ir.newBlock();
+                f.b = ir.newBlock();
+                f.a = f.elseStmt ? ir.newBlock() : f.b;
+                test(node->getChild(0), 1, f.i, f.a);
+                break;
+            }
+            if (f.state == 1) {
+                startBlock(f.i);
+                f.i = 1;
+                f.state = 2;
+            }
+            values.resize(f.values);
+            if (f.state == 2) {
+                // Skip over the first child to not build the test again for the if statement
+                while (f.i < numChildren && node->getChild(f.i)->getKind() == NodeKind::ELSE_STMT) {
+                    f.i++;
+                }
+                if (f.i < numChildren) {
+                    call(node->getChild(f.i++), 2);
+                    break;
+                }
+                if (!f.elseStmt) {
+                    startBlock(f.b);
+                    done = true;
+                    break;
+                }
+                if (!blockEnded) {
+                    emit({.op = IrOp::JUMP, .target = f.b});
+                }
+                startBlock(f.a);
+                f.i = 0;
+                f.state = 3;
+            }
+            while (f.i < numChildren && node->getChild(f.i)->getKind() != NodeKind::ELSE_STMT) {
+                f.i++;
+            }
+            if (f.i < numChildren) {
+                call(node->getChild(f.i++), 3);
+                break;
+            }
+            startBlock(f.b);
+            done = true;
+            break;
+        }
+        case NodeKind::ELSE_STMT:
+        case NodeKind::BLOCK: {
+            values.resize(f.values);
+            if (f.i < numChildren) {
+                call(node->getChild(f.i++), 1);
+                break;
+            }
+            done = true;
+            break;
+        }
+        case NodeKind::BREAK_STMT: {
+            emit({.op = IrOp::JUMP, .target = loopExits.back()});
+            done = true;
+            break;
+        }
+        case NodeKind::RET_STMT: {
+            // main returns nothing, and goes to the exit code
+            if (f.state == 0 && numChildren > 0 && !ir.isMain) {
+                call(node->getChild(0), 1);
+                break;
+            }
+            emit({.op = IrOp::RET, .a = f.state == 1 ? pop() : NO_VALUE});
+            done = true;
+            break;
+        }
+        case NodeKind::WHILE_STMT: {
+            // a is the block of the body, b the block after the loop and i the next
+            // body statement. The test is built before the body, and again after it
+            // to branch back, so an iteration only takes the one branch.
+            if (f.state == 0) {
+                f.a = ir.newBlock();
+                f.b = ir.newBlock();
+                loopExits.push_back(f.b);
+                test(node->getChild(0), 1, f.a, f.b);
+                break;
+            }
+            if (f.state == 1) {
+                startBlock(f.a);
+                f.i = 1;
+                f.state = 2;
+            }
+            values.resize(f.values);
+            if (f.state == 2) {
+                if (f.i < numChildren) {
+                    call(node->getChild(f.i++), 2);
+                    break;
+                }
+                if (!blockEnded) {
+                    test(node->getChild(0), 3, f.a, f.b);
+                    break;
+                }
+            }
+            startBlock(f.b);
+            loopExits.pop_back();
+            done = true;
+            break;
+        }
+        case NodeKind::LOGICAL: {
+            // The right operand of && and || only runs when the left one doesn't
+            // decide the result, unless it is pure, when both are combined with
+            // and/or instead. a is the local holding the result and b the block
+            // after the expression.
+            bool shortCircuit = numChildren == 2 && !isPure(node->getChild(1));
+            if (f.i == 0 || (f.i < numChildren && !shortCircuit)) {
+                call(node->getChild(f.i++), 1);
+                break;
+            }
+            if (!shortCircuit) {
+                Value right = numChildren > 1 ? pop() : NO_VALUE;
+                Value left = pop();
+                Value result = newTemp(Type::BOOLEAN);
+                emit({.op = operatorOp(node), .dst = result, .a = left, .b = right});
+                values.push_back(result);
+                done = true;
+                break;
+            }
+            if (f.i == 1) {
+                f.a = ir.newValue(Type::BOOLEAN, true);
+                assign(f.a, pop());
+                // The values of the enclosing expressions built so far are used after the jumps
+                for (Value value : values) {
+                    if (value != NO_VALUE) {
+                        ir.variables[value] = true;
+                    }
+                }
+                int right = ir.newBlock();
+                f.b = ir.newBlock();
+                bool isAnd = node->getType() == "&&";
+                emit({.op = IrOp::BRANCH, .a = f.a, .target = isAnd ? right : f.b, .elseTarget = isAnd ? f.b : right});
+                startBlock(right);
+                call(node->getChild(f.i++), 1);
+                break;
+            }
+            assign(f.a, pop());
+            startBlock(f.b);
+            values.push_back(f.a);
+            done = true;
+            break;
+        }
+        case NodeKind::ARITHMETIC:
+        case NodeKind::COMPARE: {
+            // If there's only one child, then the operator is unary '-'
+            if (f.i < numChildren) {
+                call(node->getChild(f.i++), 1);
+                break;
+            }
+            Value right = numChildren > 1 ? pop() : NO_VALUE;
+            Value left = pop();
+            Value result = newTemp(node->getKind() == NodeKind::ARITHMETIC ? Type::INT : Type::BOOLEAN);
+            emit({.op = operatorOp(node), .dst = result, .a = left, .b = right});
+            values.push_back(result);
+            done = true;
+            break;
+        }
+        case NodeKind::STRING_LIT: {
+            values.push_back(NO_VALUE);
+            done = true;
+            break;
+        }
+        default:
+            done = true;
+            break;
+        }
+
+        if (!done) {
+            continue;
+        }
+        frames.pop_back();
+        if (frames.empty()) {
+            return;
+        }
     }
-    return output;
-}
\ No newline at end of file
+}
@@ -0,0 +1,517 @@
+#ifndef CONST_FOLD_HPP
+#define CONST_FOLD_HPP
+
+#include <algorithm>
+#include <climits>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "ast.hpp"
+#include "symbolTable.hpp"
+#include "visitor.hpp"
+
+/*
+Constant folding and propagation on the checked tree, run before code generation.
+An operator whose operands are constants is replaced by a Num or Literal with its
+value, and a use of a local or parameter known to hold a constant at that point is
+replaced by the constant, so the code generator loads one immediate where it would
+have computed the value at run time. Operations the machine traps on are left in
+the tree to trap: add, sub and neg that overflow, and div and rem by zero or of
+INT_MIN by -1.
+
+The statements of each function are walked in the order they run, keeping the
+values of the locals known so far. Every change to them is logged, so both branches
+of an if start from the values before it and are then merged, keeping the values
+they agree on. A branch ending in return, break or halt() never reaches the end of
+the if and has no say. A loop first forgets the locals assigned anywhere in it, which
+are found by numbering the assignments of the function in tree order when the
+first loop is reached.
+*/
+class ConstantFolder
+{
+    public:
+    size_t folded = 0;      // Operators replaced by their value
+    size_t propagated = 0;  // Uses of variables replaced by their constant
+
+    void run(AST* root) {
+        for (AST* child : root->getChildren()) {
+            if (child->getKind() == NodeKind::MAIN_DECL || child->getKind() == NodeKind::FUNC_DECL) {
+                function(child);
+            }
+        }
+    }
+
+    private:
+    // Value of a local at some point, if it is known
+    struct Value {
+        bool known;
+        int value;
+
+        bool operator==(const Value& other) const {
+            return known == other.known && (!known || value == other.value);
+        }
+    };
+
+    struct Change {
+        entry* variable;
+        Value before;
+    };
+
+    // Numbers the assignments to locals in tree order, and gives each loop the
+    // range of numbers of the assignments inside it
+    class Assignments : public Visitor<Assignments> {
+        public:
+        std::vector<std::pair<entry*, int>> numbers;    // Sorted once the walk is done
+        std::vector<std::pair<int, int>> loops;         // In the order the loops are entered
+        std::vector<size_t> open;
+        int count = 0;
+
+        void clear() {
+            numbers.clear();
+            loops.clear();
+            count = 0;
+        }
+
+        void enter(AST* node) {
+            if (node->getKind() == NodeKind::WHILE_STMT) {
+                open.push_back(loops.size());
+                loops.push_back({count, count});
+            }
+            else if (node->getKind() == NodeKind::ASSN_STMT && node->getDecl()->scope != 1) {
+                numbers.push_back({node->getDecl(), count++});
+            }
+        }
+
+        void leave(AST* node) {
+            if (node->getKind() == NodeKind::WHILE_STMT) {
+                loops[open.back()].second = count;
+                open.pop_back();
+            }
+        }
+
+        void sort() {
+            if (!loops.empty()) {
+                std::sort(numbers.begin(), numbers.end());
+            }
+        }
+
+        bool assignedIn(entry* variable, std::pair<int, int> loop) {
+            auto first = std::lower_bound(numbers.begin(), numbers.end(), std::make_pair(variable, loop.first));
+            return first != numbers.end() && first->first == variable && first->second < loop.second;
+        }
+    };
+
+    // Walk state of one statement, kept on an explicit stack like the code generator's
+    struct Frame {
+        AST* node;
+        int state = 0;
+        int i = 0;                  // Next child to walk
+        size_t mark = 0;            // Changes logged before the branches or body
+        bool deadBefore = false;
+        bool thenDead = false;
+        std::vector<std::pair<entry*, Value>> thenValues;  // Values the then branch ends with
+
+        Frame(AST* n) : node(n) {}
+    };
+
+    std::unordered_map<entry*, int> constants;  // Locals with a known value
+    std::vector<Change> changes;
+    bool dead = false;      // Whether the statements walked can't be reached
+    Assignments assignments;
+    bool numbered = false;  // Whether assignments covers the function being walked
+    size_t nextLoop = 0;
+    std::vector<Frame> frames;
+    std::vector<std::pair<AST*, int>> path;
+    std::vector<std::pair<entry*, Value>> elseValues;
+    std::vector<entry*> forgotten;
+
+    static bool isConstant(AST* node) {
+        return node->getKind() == NodeKind::NUM || node->getKind() == NodeKind::LITERAL;
+    }
+
+    static int constantValue(AST* node) {
+        if (node->getKind() == NodeKind::LITERAL) {
+            return node->getValue() == "true" ? 1 : 0;
+        }
+        return std::stoi(node->getValue());
+    }
+
+    static AST* makeConstant(AST* node, Type type, int value) {
+        AST* constant;
+        if (type == Type::BOOLEAN) {
+            constant = new Literal(node->getLineNo(), value != 0 ? Reserved::TRUE : Reserved::FALSE);
+        }
+        else {
+            constant = new Num(node->getLineNo(), value);
+        }
+        constant->setExprType(type);
+        return constant;
+    }
+
+    Value current(entry* variable) {
+        auto found = constants.find(variable);
+        return found != constants.end() ? Value{true, found->second} : Value{false, 0};
+    }
+
+    void set(entry* variable, Value value) {
+        Value before = current(variable);
+        if (before == value) {
+            return;
+        }
+        changes.push_back({variable, before});
+        if (value.known) {
+            constants[variable] = value.value;
+        }
+        else {
+            constants.erase(variable);
+        }
+    }
+
+    // Takes back the changes logged since mark
+    void undo(size_t mark) {
+        while (changes.size() > mark) {
+            Change change = changes.back();
+            changes.pop_back();
+            if (change.before.known) {
+                constants[change.variable] = change.before.value;
+            }
+            else {
+                constants.erase(change.variable);
+            }
+        }
+    }
+
+    // The values of the locals changed since mark, sorted by local
+    void capture(size_t mark, std::vector<std::pair<entry*, Value>>& values) {
+        values.clear();
+        for (size_t i = mark; i < changes.size(); i++) {
+            values.push_back({changes[i].variable, current(changes[i].variable)});
+        }
+        std::sort(values.begin(), values.end(), [](const std::pair<entry*, Value>& a, const std::pair<entry*, Value>& b) {
+            return a.first < b.first;
+        });
+    }
+
+    // Sets the locals after an if from the values its branches end with. The
+    // values before the if must be the current ones.
+    void merge(const std::vector<std::pair<entry*, Value>>& thenValues, bool thenDead,
+               const std::vector<std::pair<entry*, Value>>& elseValues, bool elseDead) {
+        if (thenDead && elseDead) {
+            dead = true;
+            return;
+        }
+        size_t t = 0, e = 0;
+        while (t < thenValues.size() || e < elseValues.size()) {
+            entry* variable;
+            if (e == elseValues.size() || (t < thenValues.size() && thenValues[t].first < elseValues[e].first)) {
+                variable = thenValues[t].first;
+            }
+            else {
+                variable = elseValues[e].first;
+            }
+            Value before = current(variable);
+            Value thenValue = before, elseValue = before;
+            for (; t < thenValues.size() && thenValues[t].first == variable; t++) {
+                thenValue = thenValues[t].second;
+            }
+            for (; e < elseValues.size() && elseValues[e].first == variable; e++) {
+                elseValue = elseValues[e].second;
+            }
+            if (thenDead) {
+                set(variable, elseValue);
+            }
+            else if (elseDead || thenValue == elseValue) {
+                set(variable, thenValue);
+            }
+            else {
+                set(variable, Value{false, 0});
+            }
+        }
+    }
+
+    void function(AST* decl) {
+        constants.clear();
+        changes.clear();
+        dead = false;
+        numbered = false;
+        nextLoop = 0;
+
+        // Suspends the frame on top of the stack until child is walked
+        auto call = [this](AST* child) {
+            frames.emplace_back(child);
+        };
+
+        frames.emplace_back(decl);
+        while (!frames.empty()) {
+            Frame& f = frames.back();
+            AST* node = f.node;
+            int numChildren = node->numChildren();
+            bool done = true;
+            switch (node->getKind()) {
+            case NodeKind::MAIN_DECL:
+            case NodeKind::FUNC_DECL:
+            case NodeKind::BLOCK:
+            case NodeKind::ELSE_STMT: {
+                if (f.i < numChildren) {
+                    call(node->getChild(f.i++));
+                    done = false;
+                }
+                break;
+            }
+            case NodeKind::ASSN_STMT: {
+                AST* value = foldExpression(node->getChild(1));
+                node->setChild(1, value);
+                entry* variable = node->getDecl();
+                if (variable->scope != 1) {
+                    set(variable, isConstant(value) ? Value{true, constantValue(value)} : Value{false, 0});
+                }
+                break;
+            }
+            case NodeKind::FUNC_CALL: {
+                foldExpression(node);
+                if (node->getSymbol() == SYM_HALT) {
+                    dead = true;
+                }
+                break;
+            }
+            case NodeKind::RET_STMT: {
+                if (numChildren > 0) {
+                    node->setChild(0, foldExpression(node->getChild(0)));
+                }
+                dead = true;
+                break;
+            }
+            case NodeKind::BREAK_STMT: {
+                dead = true;
+                break;
+            }
+            case NodeKind::IF_STMT: {
+                // The children after the test up to the else statement are the then branch
+                if (f.state == 0) {
+                    node->setChild(0, foldExpression(node->getChild(0)));
+                    f.mark = changes.size();
+                    f.deadBefore = dead;
+                    f.i = 1;
+                    f.state = 1;
+                }
+                AST* test = node->getChild(0);
+                if (f.state == 1) {
+                    if (f.i < numChildren && node->getChild(f.i)->getKind() != NodeKind::ELSE_STMT) {
+                        call(node->getChild(f.i++));
+                        done = false;
+                        break;
+                    }
+                    f.thenDead = dead || (isConstant(test) && constantValue(test) == 0);
+                    capture(f.mark, f.thenValues);
+                    undo(f.mark);
+                    dead = f.deadBefore;
+                    f.state = 2;
+                    if (f.i < numChildren) {
+                        call(node->getChild(f.i++));
+                        done = false;
+                        break;
+                    }
+                }
+                bool elseDead = dead || (isConstant(test) && constantValue(test) != 0);
+                capture(f.mark, elseValues);
+                undo(f.mark);
+                dead = f.deadBefore;
+                merge(f.thenValues, f.thenDead, elseValues, elseDead);
+                break;
+            }
+            case NodeKind::WHILE_STMT: {
+                // Whatever the body assigns is unknown from the second time round,
+                // and after the loop
+                if (f.state == 0) {
+                    if (!numbered) {
+                        assignments.clear();
+                        assignments.walk(frames.front().node);
+                        assignments.sort();
+                        numbered = true;
+                    }
+                    std::pair<int, int> loop = assignments.loops[nextLoop++];
+                    forgotten.clear();
+                    for (auto& constant : constants) {
+                        if (assignments.assignedIn(constant.first, loop)) {
+                            forgotten.push_back(constant.first);
+                        }
+                    }
+                    for (entry* variable : forgotten) {
+                        set(variable, Value{false, 0});
+                    }
+                    node->setChild(0, foldExpression(node->getChild(0)));
+                    f.mark = changes.size();
+                    f.deadBefore = dead;
+                    f.i = 1;
+                    f.state = 1;
+                }
+                if (f.i < numChildren) {
+                    call(node->getChild(f.i++));
+                    done = false;
+                    break;
+                }
+                undo(f.mark);
+                dead = f.deadBefore;
+                break;
+            }
+            default:
+                break;
+            }
+
+            if (done) {
+                frames.pop_back();
+            }
+        }
+    }
+
+    // Folds the expression under root from the bottom up and returns what takes
+    // its place. The path to the current node is kept on an explicit stack.
+    AST* foldExpression(AST* root) {
+        AST* result = root;
+        path.push_back({root, 0});
+        while (!path.empty()) {
+            AST* node = path.back().first;
+            int next = path.back().second;
+            if (next < node->numChildren()) {
+                path.back().second++;
+                // The target of an assignment isn't a use
+                if (next == 0 && node->getKind() == NodeKind::ASSN_STMT) {
+                    continue;
+                }
+                path.push_back({node->getChild(next), 0});
+                continue;
+            }
+            path.pop_back();
+            AST* value = fold(node);
+            if (path.empty()) {
+                result = value;
+            }
+            else if (value != node) {
+                path.back().first->setChild(path.back().second - 1, value);
+            }
+        }
+        return result;
+    }
+
+    // Returns the constant a node with folded children has the value of, or the
+    // node itself
+    AST* fold(AST* node) {
+        switch (node->getKind()) {
+        case NodeKind::ID: {
+            entry* variable = node->getDecl();
+            if (variable == nullptr || variable->scope == 1) {
+                return node;
+            }
+            auto found = constants.find(variable);
+            if (found == constants.end()) {
+                return node;
+            }
+            propagated++;
+            return makeConstant(node, variable->type, found->second);
+        }
+        case NodeKind::ASSN_STMT: {
+            // An assignment used as a value, which may run before or after the
+            // other operands, so the local is just unknown from here on
+            if (node->getDecl()->scope != 1) {
+                set(node->getDecl(), Value{false, 0});
+            }
+            return node;
+        }
+        case NodeKind::ARITHMETIC: {
+            std::string oper = node->getType();
+            AST* left = node->getChild(0);
+            if (!isConstant(left)) {
+                return node;
+            }
+            long long a = constantValue(left);
+            long long result;
+            if (node->numChildren() == 1) {
+                result = -a;
+            }
+            else {
+                AST* right = node->getChild(1);
+                if (!isConstant(right)) {
+                    return node;
+                }
+                long long b = constantValue(right);
+                if (oper == "+") {
+                    result = a + b;
+                }
+                else if (oper == "-") {
+                    result = a - b;
+                }
+                else if (oper == "*") {
+                    // mul keeps the low word without trapping
+                    result = static_cast<int>(static_cast<uint32_t>(a * b));
+                }
+                else if (b == 0 || (a == INT_MIN && b == -1)) {
+                    return node;
+                }
+                else if (oper == "/") {
+                    result = a / b;
+                }
+                else {
+                    result = a % b;
+                }
+            }
+            if (result < INT_MIN || result > INT_MAX) {
+                return node;
+            }
+            folded++;
+            return makeConstant(node, Type::INT, static_cast<int>(result));
+        }
+        case NodeKind::COMPARE: {
+            AST* left = node->getChild(0);
+            AST* right = node->getChild(1);
+            if (!isConstant(left) || !isConstant(right)) {
+                return node;
+            }
+            std::string oper = node->getType();
+            int a = constantValue(left), b = constantValue(right);
+            bool result;
+            if (oper == "<") result = a < b;
+            else if (oper == ">") result = a > b;
+            else if (oper == "<=") result = a <= b;
+            else if (oper == ">=") result = a >= b;
+            else if (oper == "==") result = a == b;
+            else result = a != b;
+            folded++;
+            return makeConstant(node, Type::BOOLEAN, result);
+        }
+        case NodeKind::LOGICAL: {
+            std::string oper = node->getType();
+            AST* left = node->getChild(0);
+            if (node->numChildren() == 1) {
+                if (!isConstant(left)) {
+                    return node;
+                }
+                folded++;
+                return makeConstant(node, Type::BOOLEAN, constantValue(left) == 0);
+            }
+            // The right operand only runs when the left one doesn't decide the
+            // result, so a constant left operand either decides it or leaves the
+            // right one. A constant right operand that doesn't decide it can go,
+            // but one that does can't drop the left one.
+            AST* right = node->getChild(1);
+            bool isAnd = oper == "&&";
+            if (isConstant(left)) {
+                folded++;
+                if ((constantValue(left) != 0) == isAnd) {
+                    return right;
+                }
+                return makeConstant(node, Type::BOOLEAN, !isAnd);
+            }
+            if (isConstant(right) && (constantValue(right) != 0) == isAnd) {
+                folded++;
+                return left;
+            }
+            return node;
+        }
+        default:
+            return node;
+        }
+    }
+};
+
+#endif
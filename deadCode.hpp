@@ -0,0 +1,162 @@
+#ifndef DEAD_CODE_HPP
+#define DEAD_CODE_HPP
+
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include "ast.hpp"
+#include "symbolTable.hpp"
+
+/*
+Removes the code that can never run from the checked tree, so the code generator
+doesn't lower it. Functions are walked from main through the calls they make, and
+the ones never reached are dropped from the program. In the functions walked, the
+statements after one that doesn't complete, a return, break or call to halt() or
+an if whose branches both don't, are dropped, and so is the dead branch of an if
+or while whose test is a constant, which constant folding leaves behind.
+
+The statements of a block are only entered after the ones before them are known
+to complete, so the calls in dropped code don't keep functions alive.
+*/
+class DeadCodeEliminator
+{
+    public:
+    size_t functionsRemoved = 0;
+    size_t statementsRemoved = 0;  // Statements after one that doesn't complete
+    size_t branchesRemoved = 0;    // Branches of ifs and whiles with a constant test
+
+    void run(AST* root) {
+        std::unordered_map<Symbol, AST*> functions;
+        AST* mainDecl = nullptr;
+        for (AST* child : root->getChildren()) {
+            if (child->getKind() == NodeKind::FUNC_DECL) {
+                functions[child->getSymbol()] = child;
+            }
+            else if (child->getKind() == NodeKind::MAIN_DECL) {
+                mainDecl = child;
+            }
+        }
+        if (mainDecl == nullptr) {
+            return;
+        }
+
+        reached.clear();
+        pending.clear();
+        function(mainDecl);
+        while (!pending.empty()) {
+            Symbol name = pending.back();
+            pending.pop_back();
+            auto found = functions.find(name);
+            if (found != functions.end()) {
+                function(found->second);
+            }
+        }
+
+        int kept = 0;
+        for (int i = 0; i < root->numChildren(); i++) {
+            AST* child = root->getChild(i);
+            if (child->getKind() == NodeKind::FUNC_DECL && reached.count(child->getSymbol()) == 0) {
+                functionsRemoved++;
+                continue;
+            }
+            root->setChild(kept++, child);
+        }
+        root->truncateChildren(kept);
+    }
+
+    private:
+    std::unordered_set<Symbol> reached;         // Functions called from reached code
+    std::vector<Symbol> pending;                // Reached functions not walked yet
+    std::vector<std::pair<AST*, int>> path;
+    std::vector<char> completes;    // Whether each walked child of the nodes on path can complete
+
+    static bool isList(AST* node) {
+        return node->getKind() == NodeKind::BLOCK || node->getKind() == NodeKind::FUNC_DECL ||
+               node->getKind() == NodeKind::MAIN_DECL;
+    }
+
+    static bool isConstant(AST* node) {
+        return node->getKind() == NodeKind::NUM || node->getKind() == NodeKind::LITERAL;
+    }
+
+    // The statement that runs in place of an if or while with a constant test
+    AST* simplify(AST* node) {
+        while (true) {
+            NodeKind kind = node->getKind();
+            if ((kind != NodeKind::IF_STMT && kind != NodeKind::WHILE_STMT) || !isConstant(node->getChild(0))) {
+                return node;
+            }
+            bool test = node->getChild(0)->getValue() == "true";
+            if (kind == NodeKind::WHILE_STMT) {
+                if (test) {
+                    return node;
+                }
+                node = new NullStmt(node->getLineNo());
+            }
+            else if (test) {
+                node = node->getChild(1);
+            }
+            else if (node->numChildren() > 2) {
+                node = node->getChild(2)->getChild(0);
+            }
+            else {
+                node = new NullStmt(node->getLineNo());
+            }
+            branchesRemoved++;
+        }
+    }
+
+    // Whether a statement whose children were walked can complete and go on to
+    // the next one. The results of its children are on top of completes.
+    bool canComplete(AST* node, int numChildren) {
+        const char* results = completes.data() + completes.size() - numChildren;
+        switch (node->getKind()) {
+        case NodeKind::RET_STMT:
+        case NodeKind::BREAK_STMT:
+            return false;
+        case NodeKind::FUNC_CALL:
+            return node->getSymbol() != SYM_HALT;
+        case NodeKind::BLOCK:
+        case NodeKind::ELSE_STMT:
+            return numChildren == 0 || results[numChildren - 1];
+        case NodeKind::IF_STMT:
+            return numChildren < 3 || results[1] || results[2];
+        default:
+            return true;
+        }
+    }
+
+    // Prunes the statements of a function and finds the functions it calls. The
+    // path to the current node is kept on an explicit stack.
+    void function(AST* decl) {
+        reached.insert(decl->getSymbol());
+        completes.clear();
+        path.push_back({decl, 0});
+        while (!path.empty()) {
+            AST* node = path.back().first;
+            int next = path.back().second;
+            // Nothing after a statement that doesn't complete can run
+            if (isList(node) && next > 0 && !completes.back() && next < node->numChildren()) {
+                statementsRemoved += node->numChildren() - next;
+                node->truncateChildren(next);
+            }
+            if (next < node->numChildren()) {
+                path.back().second++;
+                AST* child = simplify(node->getChild(next));
+                node->setChild(next, child);
+                path.push_back({child, 0});
+                continue;
+            }
+            path.pop_back();
+            if (node->getKind() == NodeKind::FUNC_CALL && node->getDecl()->scope == 1 && reached.insert(node->getSymbol()).second) {
+                pending.push_back(node->getSymbol());
+            }
+            bool result = canComplete(node, node->numChildren());
+            completes.resize(completes.size() - node->numChildren());
+            completes.push_back(result);
+        }
+    }
+};
+
+#endif
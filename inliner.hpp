@@ -0,0 +1,398 @@
+#ifndef INLINER_HPP
+#define INLINER_HPP
+
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "ir.hpp"
+
+/*
+Inlines calls between the functions of the program, on their IR before any of
+them is lowered. A call is replaced by the code of the function it calls when
+that is a leaf, calling no function of the program, of at most threshold IR
+instructions, or when it is the only call of the function left and the function
+is at most singleThreshold instructions. That doesn't add code, but a chain of
+functions each called once by the next would otherwise be copied into one
+another down its whole length. The values and
+blocks of the callee are numbered after the caller's, so its locals and
+parameters are values of their own. The arguments are copied into the
+parameters, and each return becomes a copy into the result of the call and a
+jump to the code after the call, which gets a block of its own.
+
+Functions are visited callees first, in a walk of the call graph that doesn't
+follow recursive calls, so what was inlined into a function goes along when the
+function is inlined in turn, and a function left calling nothing is a leaf. A
+function is never inlined into itself. One whose calls were all inlined is
+removed, while one that was never called is kept.
+*/
+class Inliner
+{
+    public:
+    struct Inlined {
+        Symbol caller;
+        Symbol callee;
+        bool onlyCall;      // Whether it was inlined as the only call of the callee rather than as a call of a small leaf
+        int size;           // IR instructions of the callee
+    };
+
+    int threshold = 20;                 // Most instructions of a leaf inlined at every call
+    int singleThreshold = 200;          // Most instructions of a function inlined at its only call
+    size_t functionsRemoved = 0;
+    std::vector<Inlined> inlined;       // Calls inlined, for --inline-report
+
+    void run(std::vector<IrFunction>& functions) {
+        this->functions = &functions;
+        size_t n = functions.size();
+        index.clear();
+        for (size_t i = 0; i < n; i++) {
+            if (!functions[i].isMain) {
+                index[functions[i].name] = i;
+            }
+        }
+        removed.assign(n, false);
+        calls.assign(n, 0);
+        leaves.assign(n, false);
+        sizes.assign(n, 0);
+        edges.assign(n, {});
+        for (size_t i = 0; i < n; i++) {
+            measure(i);
+            edges[i] = callees;
+            for (int called : callees) {
+                calls[called]++;
+            }
+        }
+        for (int caller : callersLast()) {
+            if (!removed[caller]) {
+                inlineCalls(caller);
+                measure(caller);
+            }
+        }
+    }
+
+    bool isRemoved(size_t function) const {
+        return function < removed.size() && removed[function];
+    }
+
+    private:
+    std::vector<IrFunction>* functions = nullptr;
+    std::unordered_map<Symbol, int> index;  // Function of each name, other than main
+    std::vector<bool> removed;
+    std::vector<int> calls;                 // Calls of each function in the code kept
+    std::vector<bool> leaves;
+    std::vector<int> sizes;
+    std::vector<int> callees;               // Functions called by the function last measured, once per call
+    std::vector<std::vector<int>> edges;    // Functions each one calls before inlining
+    std::vector<bool> reached;
+
+    // Function of the program a call is to, or -1 for a library function
+    int callee(const IrInstr& in) const {
+        if (in.op != IrOp::CALL) {
+            return -1;
+        }
+        auto found = index.find(in.name);
+        return found == index.end() ? -1 : found->second;
+    }
+
+    // Finds the size of a function and the calls it makes, in its reachable blocks
+    void measure(int function) {
+        const IrFunction& f = (*functions)[function];
+        findReachable(f, reached);
+        callees.clear();
+        int size = 0;
+        for (int block : f.layout) {
+            if (!reached[block]) {
+                continue;
+            }
+            size += f.blocks[block].end - f.blocks[block].begin;
+            for (int i = f.blocks[block].begin; i < f.blocks[block].end; i++) {
+                int called = callee(f.code[i]);
+                if (called >= 0) {
+                    callees.push_back(called);
+                }
+            }
+        }
+        sizes[function] = size;
+        leaves[function] = callees.empty();
+    }
+
+    // The functions in an order where each comes after the ones it calls, except
+    // through a cycle of calls. The call graph is walked on an explicit stack.
+    std::vector<int> callersLast() {
+        size_t n = functions->size();
+        std::vector<int> order;
+        std::vector<char> visited(n, false);
+        std::vector<std::pair<int, size_t>> path;
+        for (size_t root = 0; root < n; root++) {
+            if (visited[root]) {
+                continue;
+            }
+            visited[root] = true;
+            path.push_back({root, 0});
+            while (!path.empty()) {
+                int function = path.back().first;
+                size_t next = path.back().second++;
+                if (next < edges[function].size()) {
+                    int called = edges[function][next];
+                    if (!visited[called]) {
+                        visited[called] = true;
+                        path.push_back({called, 0});
+                    }
+                    continue;
+                }
+                order.push_back(function);
+                path.pop_back();
+            }
+        }
+        return order;
+    }
+
+    bool shouldInline(int caller, int called) const {
+        return called != caller && !removed[called] &&
+               ((calls[called] == 1 && sizes[called] <= singleThreshold) || (leaves[called] && sizes[called] <= threshold));
+    }
+
+    // Rebuilds a function with the calls worth it inlined. Its blocks keep their
+    // numbers, those of the code inlined and after each call are added after them.
+    void inlineCalls(int caller) {
+        IrFunction& f = (*functions)[caller];
+        bool any = false;
+        findReachable(f, reached);
+        for (int block : f.layout) {
+            for (int i = f.blocks[block].begin; reached[block] && i < f.blocks[block].end; i++) {
+                int called = callee(f.code[i]);
+                any = any || (called >= 0 && shouldInline(caller, called));
+            }
+        }
+        if (!any) {
+            return;
+        }
+
+        IrFunction out;
+        out.name = f.name;
+        out.isMain = f.isMain;
+        out.returnType = f.returnType;
+        out.numParams = f.numParams;
+        out.types = f.types;
+        out.variables = f.variables;
+        out.args = f.args;
+        out.strings = f.strings;
+        out.blocks.resize(f.blocks.size());
+        std::vector<bool> callerReached = reached;
+        for (int block : f.layout) {
+            if (!callerReached[block]) {
+                continue;
+            }
+            int current = block;
+            out.blocks[current].begin = out.code.size();
+            out.layout.push_back(current);
+            for (int i = f.blocks[block].begin; i < f.blocks[block].end; i++) {
+                const IrInstr& in = f.code[i];
+                int called = callee(in);
+                if (called < 0 || !shouldInline(caller, called)) {
+                    out.code.push_back(in);
+                    continue;
+                }
+                int after = out.newBlock();
+                inlineCall(out, in, called, current, after);
+                current = after;
+                out.blocks[current].begin = out.code.size();
+                out.layout.push_back(current);
+            }
+            out.blocks[current].end = out.code.size();
+        }
+        promoteTemporaries(out);
+        f = std::move(out);
+    }
+
+    // Ends block current of out with a jump into a copy of the function called,
+    // whose returns jump to block after
+    void inlineCall(IrFunction& out, const IrInstr& call, int called, int current, int after) {
+        const IrFunction& body = (*functions)[called];
+        // A small leaf is inlined at every call, the last one included
+        bool onlyCall = !(leaves[called] && sizes[called] <= threshold);
+        inlined.push_back({out.name, body.name, onlyCall, sizes[called]});
+        Value values = out.types.size();
+        int blocks = out.blocks.size();
+        int strings = out.strings.size();
+        out.types.insert(out.types.end(), body.types.begin(), body.types.end());
+        out.variables.insert(out.variables.end(), body.variables.begin(), body.variables.end());
+        out.strings.insert(out.strings.end(), body.strings.begin(), body.strings.end());
+        out.blocks.resize(blocks + body.blocks.size());
+        // The result is set by every return
+        if (call.dst != NO_VALUE) {
+            out.variables[call.dst] = true;
+        }
+
+        for (int k = 0; k < call.count; k++) {
+            out.code.push_back({.op = IrOp::COPY, .dst = values + k, .a = out.args[call.imm + k]});
+        }
+        // Locals read before they are assigned start out as 0 at every call, as
+        // they would at the entry of the function
+        for (Value local : readBeforeAssigned(body)) {
+            if (local >= body.numParams) {
+                out.code.push_back({.op = IrOp::CONST, .dst = values + local, .imm = 0});
+            }
+        }
+        out.code.push_back({.op = IrOp::JUMP, .target = blocks + body.layout[0]});
+        out.blocks[current].end = out.code.size();
+
+        findReachable(body, reached);
+        for (int block : body.layout) {
+            if (!reached[block]) {
+                continue;
+            }
+            out.blocks[blocks + block].begin = out.code.size();
+            out.layout.push_back(blocks + block);
+            for (int i = body.blocks[block].begin; i < body.blocks[block].end; i++) {
+                IrInstr in = body.code[i];
+                auto renumber = [values](Value& value) {
+                    if (value != NO_VALUE) {
+                        value += values;
+                    }
+                };
+                renumber(in.dst);
+                renumber(in.a);
+                renumber(in.b);
+                switch (in.op) {
+                    case IrOp::JUMP:
+                    case IrOp::BRANCH:
+                        in.target += blocks;
+                        in.elseTarget += blocks;
+                        break;
+                    case IrOp::CALL:
+                        if (in.name == SYM_PRINTS) {
+                            in.imm += strings;
+                            break;
+                        }
+                        for (int k = 0; k < in.count; k++) {
+                            out.args.push_back(body.args[in.imm + k] + values);
+                        }
+                        in.imm = out.args.size() - in.count;
+                        if (callee(in) >= 0) {
+                            calls[callee(in)]++;
+                        }
+                        break;
+                    case IrOp::RET:
+                        if (call.dst != NO_VALUE && in.a != NO_VALUE) {
+                            out.code.push_back({.op = IrOp::COPY, .dst = call.dst, .a = in.a});
+                        }
+                        in = {.op = IrOp::JUMP, .target = after};
+                        break;
+                    default:
+                        break;
+                }
+                out.code.push_back(in);
+            }
+            out.blocks[blocks + block].end = out.code.size();
+        }
+
+        if (--calls[called] == 0) {
+            remove(called);
+        }
+    }
+
+    // Variables of a function that some path reads before assigning them, that is
+    // those live at its entry, found by iterating liveness over its blocks
+    static std::vector<Value> readBeforeAssigned(const IrFunction& function) {
+        size_t numValues = function.types.size();
+        size_t numBlocks = function.blocks.size();
+        std::vector<std::vector<bool>> used(numBlocks), assigned(numBlocks), live(numBlocks);
+        std::vector<bool> reachable;
+        findReachable(function, reachable);
+        std::vector<int> blocks;
+        for (int block : function.layout) {
+            if (reachable[block]) {
+                blocks.push_back(block);
+            }
+        }
+        for (int block : blocks) {
+            used[block].assign(numValues, false);
+            assigned[block].assign(numValues, false);
+            live[block].assign(numValues, false);
+            for (int i = function.blocks[block].begin; i < function.blocks[block].end; i++) {
+                const IrInstr& in = function.code[i];
+                auto use = [&](Value value) {
+                    if (value != NO_VALUE && function.variables[value] && !assigned[block][value]) {
+                        used[block][value] = true;
+                    }
+                };
+                use(in.a);
+                use(in.b);
+                if (in.op == IrOp::CALL && in.name != SYM_PRINTS) {
+                    for (int k = 0; k < in.count; k++) {
+                        use(function.args[in.imm + k]);
+                    }
+                }
+                if (in.dst != NO_VALUE) {
+                    assigned[block][in.dst] = true;
+                }
+            }
+            live[block] = used[block];
+        }
+
+        // Live into a block: used there, or live into a successor and not assigned there
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (auto block = blocks.rbegin(); block != blocks.rend(); ++block) {
+                const IrInstr& last = function.code[function.blocks[*block].end - 1];
+                int targets[] = {last.target, last.elseTarget};
+                int numTargets = last.op == IrOp::BRANCH ? 2 : last.op == IrOp::JUMP ? 1 : 0;
+                for (int t = 0; t < numTargets; t++) {
+                    for (size_t v = 0; v < numValues; v++) {
+                        if (live[targets[t]][v] && !assigned[*block][v] && !live[*block][v]) {
+                            live[*block][v] = true;
+                            changed = true;
+                        }
+                    }
+                }
+            }
+        }
+
+        std::vector<Value> locals;
+        for (size_t v = 0; v < numValues; v++) {
+            if (live[function.layout[0]][v]) {
+                locals.push_back(v);
+            }
+        }
+        return locals;
+    }
+
+    // Drops a function no longer called, and the calls it makes
+    void remove(int function) {
+        removed[function] = true;
+        functionsRemoved++;
+        measure(function);
+        for (int called : callees) {
+            calls[called]--;
+        }
+    }
+
+    // Makes the temporaries used outside the block assigning them variables: the
+    // values computed before a call and used after it, now that the call splits the block
+    static void promoteTemporaries(IrFunction& function) {
+        std::vector<int> home(function.types.size(), -1);
+        for (int block : function.layout) {
+            for (int i = function.blocks[block].begin; i < function.blocks[block].end; i++) {
+                const IrInstr& in = function.code[i];
+                auto use = [&](Value value) {
+                    if (value != NO_VALUE && !function.variables[value] && home[value] != block) {
+                        function.variables[value] = true;
+                    }
+                };
+                use(in.a);
+                use(in.b);
+                if (in.op == IrOp::CALL && in.name != SYM_PRINTS) {
+                    for (int k = 0; k < in.count; k++) {
+                        use(function.args[in.imm + k]);
+                    }
+                }
+                if (in.dst != NO_VALUE) {
+                    home[in.dst] = block;
+                }
+            }
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,137 @@
+#ifndef INTERN_HPP
+#define INTERN_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "arena.hpp"
+
+// View of characters owned by someone else: the mapped source file, the
+// interning table or the AST arena. Token values and names are passed as views.
+struct StrRef {
+    const char *data;
+    uint32_t len;
+
+    std::string str() const {
+        return std::string(data, len);
+    }
+};
+
+inline std::ostream &operator<<(std::ostream &os, StrRef ref) {
+    return os.write(ref.data, ref.len);
+}
+
+// Every identifier is interned once by the scanner, after that the AST,
+// symbol tables and code generator only pass around its 32-bit id.
+typedef uint32_t Symbol;
+
+// Symbol 0 is the empty name, used by nodes that don't have one
+const Symbol NO_SYMBOL = 0;
+
+// The j-- library functions are interned first so their ids are known constants
+enum Builtin : Symbol {SYM_GETCHAR = 1, SYM_HALT, SYM_PRINTB, SYM_PRINTC, SYM_PRINTI, SYM_PRINTS};
+
+/*
+Interning table. Names are stored once and looked up with an open addressing
+hash table keyed on the raw characters, so a lookup of an already interned
+name does not allocate. Names that live in a buffer that outlives the
+compilation (the memory mapped source) are referenced in place, other names
+are copied into the table's own arena.
+*/
+class Interner
+{
+    private:
+    std::vector<StrRef> names;
+    Arena storage;
+    std::vector<Symbol> slots;  // 0 marks an empty slot, otherwise symbol + 1
+    size_t mask = 0;
+
+    static uint32_t hash(const char *str, size_t len) {
+        uint32_t h = 2166136261u;
+        for (size_t i = 0; i < len; i++) {
+            h = (h ^ static_cast<unsigned char>(str[i])) * 16777619u;
+        }
+        return h;
+    }
+
+    void grow() {
+        std::vector<Symbol> old;
+        old.swap(slots);
+        slots.assign(old.empty() ? 256 : old.size() * 2, 0);
+        mask = slots.size() - 1;
+        for (Symbol slot : old) {
+            if (slot != 0) {
+                StrRef name = names[slot - 1];
+                size_t i = hash(name.data, name.len) & mask;
+                while (slots[i] != 0) {
+                    i = (i + 1) & mask;
+                }
+                slots[i] = slot;
+            }
+        }
+    }
+
+    Symbol lookup(const char *str, size_t len, bool stable) {
+        // Keep the load factor under one half
+        if ((names.size() + 1) * 2 > slots.size()) {
+            grow();
+        }
+        size_t i = hash(str, len) & mask;
+        while (slots[i] != 0) {
+            StrRef name = names[slots[i] - 1];
+            if (name.len == len && std::memcmp(name.data, str, len) == 0) {
+                return slots[i] - 1;
+            }
+            i = (i + 1) & mask;
+        }
+        if (!stable) {
+            char *copy = static_cast<char*>(storage.allocate(len + 1, 1));
+            std::memcpy(copy, str, len);
+            copy[len] = '\0';
+            str = copy;
+        }
+        names.push_back({str, static_cast<uint32_t>(len)});
+        slots[i] = names.size();
+        return names.size() - 1;
+    }
+
+    public:
+    Interner() {
+        internStable("", 0);
+        internStable("getchar", 7);
+        internStable("halt", 4);
+        internStable("printb", 6);
+        internStable("printc", 6);
+        internStable("printi", 6);
+        internStable("prints", 6);
+    }
+
+    // Interns a copy of the given characters
+    Symbol intern(const char *str, size_t len) {
+        return lookup(str, len, false);
+    }
+
+    Symbol intern(const std::string &str) {
+        return lookup(str.data(), str.size(), false);
+    }
+
+    // Interns characters that stay valid for the rest of the compilation without copying them
+    Symbol internStable(const char *str, size_t len) {
+        return lookup(str, len, true);
+    }
+
+    StrRef name(Symbol sym) const {
+        return names[sym];
+    }
+
+    size_t size() const {
+        return names.size();
+    }
+};
+
+// Global interning table shared by the scanner, parser and every later pass
+extern Interner interner;
+
+#endif
@@ -0,0 +1,264 @@
+#ifndef IR_HPP
+#define IR_HPP
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "ast.hpp"
+#include "intern.hpp"
+
+struct entry;
+
+// Values are the virtual registers of a function, numbered from 0. Each has a
+// type. The parameters come first, in order.
+typedef int Value;
+const Value NO_VALUE = -1;
+
+enum class IrOp : uint8_t {
+    CONST,          // dst = imm
+    COPY,           // dst = a
+    LOAD,           // dst = @name, a global variable
+    STORE,          // @name = a
+    ADD, SUB, MUL, DIV, REM,    // dst = a op b
+    EQ, NE, LT, LE, GT, GE,     // dst = a op b, a boolean
+    AND, OR,        // dst = a op b on booleans
+    NEG, NOT,       // dst = op a
+    // dst = name(args), dst is NO_VALUE when nothing is returned. The arguments
+    // are count values from imm on in the function's args. A call to prints has
+    // the string imm in the function's strings instead.
+    CALL,
+    // Terminators, which end every block and are found nowhere else
+    JUMP,           // jump target
+    BRANCH,         // branch a, target, elseTarget: to target if a is true
+    RET,            // ret a, or ret when a is NO_VALUE
+    HALT            // The program stops
+};
+
+struct IrInstr {
+    IrOp op;
+    Value dst = NO_VALUE;
+    Value a = NO_VALUE;
+    Value b = NO_VALUE;
+    int imm = 0;                // Constant, first argument or string of a call
+    int count = 0;              // Number of arguments of a call
+    int target = 0;             // Blocks a jump or branch goes to
+    int elseTarget = 0;
+    Symbol name = NO_SYMBOL;    // Function called, or global variable loaded or stored
+    entry* variable = nullptr;  // Symbol table entry of the global
+};
+
+inline bool isTerminator(IrOp op) {
+    return op == IrOp::JUMP || op == IrOp::BRANCH || op == IrOp::RET || op == IrOp::HALT;
+}
+
+/*
+Three-address code of one function, made from the checked tree by the code
+generator and turned into MIPS by the instruction selector. It is divided into
+basic blocks ending in a terminator, so control only moves between blocks, and
+explicitly. Locals and parameters are values like the temporaries, except they
+may be assigned any number of times. Temporaries are assigned once and only used
+in the block that assigns them.
+
+The instructions of all blocks are kept in one list, where each block is a range.
+Blocks are numbered as they are created, which can be before the code jumping to
+them is made, and layout lists them in the order their code was added. A block
+with no code jumping to it, such as the code after a return, is never lowered.
+*/
+struct IrFunction {
+    struct Block {
+        int begin = 0;
+        int end = 0;
+    };
+
+    Symbol name = NO_SYMBOL;
+    bool isMain = false;
+    Type returnType = Type::VOID;
+    int numParams = 0;
+    std::vector<Type> types;        // Type of each value
+    std::vector<bool> variables;    // Which values are locals or parameters
+    std::vector<IrInstr> code;
+    std::vector<Block> blocks;
+    std::vector<int> layout;
+    std::vector<Value> args;
+    std::vector<std::string> strings;
+
+    void clear() {
+        name = NO_SYMBOL;
+        isMain = false;
+        returnType = Type::VOID;
+        numParams = 0;
+        types.clear();
+        variables.clear();
+        code.clear();
+        blocks.clear();
+        layout.clear();
+        args.clear();
+        strings.clear();
+    }
+
+    Value newValue(Type type, bool variable) {
+        types.push_back(type);
+        variables.push_back(variable);
+        return types.size() - 1;
+    }
+
+    int newBlock() {
+        blocks.emplace_back();
+        return blocks.size() - 1;
+    }
+};
+
+// Marks the blocks control can reach from the entry block, the first in layout
+inline void findReachable(const IrFunction& function, std::vector<bool>& reached) {
+    reached.assign(function.blocks.size(), false);
+    static std::vector<int> work;
+    work.clear();
+    if (!function.layout.empty()) {
+        work.push_back(function.layout[0]);
+        reached[work.back()] = true;
+    }
+    while (!work.empty()) {
+        const IrInstr& last = function.code[function.blocks[work.back()].end - 1];
+        work.pop_back();
+        int targets[] = {last.target, last.elseTarget};
+        int numTargets = last.op == IrOp::BRANCH ? 2 : last.op == IrOp::JUMP ? 1 : 0;
+        for (int i = 0; i < numTargets; i++) {
+            if (!reached[targets[i]]) {
+                reached[targets[i]] = true;
+                work.push_back(targets[i]);
+            }
+        }
+    }
+}
+
+inline const char* irOpName(IrOp op) {
+    switch (op) {
+        case IrOp::CONST: return "const";
+        case IrOp::COPY: return "copy";
+        case IrOp::LOAD: return "load";
+        case IrOp::STORE: return "store";
+        case IrOp::ADD: return "add";
+        case IrOp::SUB: return "sub";
+        case IrOp::MUL: return "mul";
+        case IrOp::DIV: return "div";
+        case IrOp::REM: return "rem";
+        case IrOp::EQ: return "eq";
+        case IrOp::NE: return "ne";
+        case IrOp::LT: return "lt";
+        case IrOp::LE: return "le";
+        case IrOp::GT: return "gt";
+        case IrOp::GE: return "ge";
+        case IrOp::AND: return "and";
+        case IrOp::OR: return "or";
+        case IrOp::NEG: return "neg";
+        case IrOp::NOT: return "not";
+        case IrOp::CALL: return "call";
+        case IrOp::JUMP: return "jump";
+        case IrOp::BRANCH: return "branch";
+        case IrOp::RET: return "ret";
+        case IrOp::HALT: return "halt";
+        default: return "";
+    }
+}
+
+/*
+Writes a function in the textual form of the IR, for --dump-ir:
+
+    function f(%0: int, %1: int): int
+    L0:
+        %2: boolean = lt %0, %1
+        branch %2, L1, L2
+    L1:
+        %3: int = call f(%1, %0)
+        ret %3
+    L2:
+        %4: int = load @g
+        ret %4
+
+Values are written %N with their type where they are assigned, and blocks are
+numbered LN in layout order. Blocks nothing jumps to are left out.
+*/
+inline void dumpIr(std::ostream& out, const IrFunction& function) {
+    std::vector<bool> reached;
+    findReachable(function, reached);
+    std::vector<int> position(function.blocks.size(), -1);
+    int numbered = 0;
+    for (int block : function.layout) {
+        if (reached[block]) {
+            position[block] = numbered++;
+        }
+    }
+
+    auto value = [&out](Value v) -> std::ostream& {
+        return out << "%" << v;
+    };
+    out << "function " << (function.isMain ? "main" : interner.name(function.name).str()) << "(";
+    for (int i = 0; i < function.numParams; i++) {
+        value(i) << ": " << typeName(function.types[i]) << (i + 1 < function.numParams ? ", " : "");
+    }
+    out << ")";
+    if (!function.isMain) {
+        out << ": " << typeName(function.returnType);
+    }
+    out << "\n";
+    for (int block : function.layout) {
+        if (!reached[block]) {
+            continue;
+        }
+        out << "L" << position[block] << ":\n";
+        for (int i = function.blocks[block].begin; i < function.blocks[block].end; i++) {
+            const IrInstr& in = function.code[i];
+            out << "    ";
+            if (in.dst != NO_VALUE) {
+                value(in.dst) << ": " << typeName(function.types[in.dst]) << " = ";
+            }
+            out << irOpName(in.op);
+            switch (in.op) {
+                case IrOp::CONST:
+                    out << " " << in.imm;
+                    break;
+                case IrOp::LOAD:
+                    out << " @" << interner.name(in.name);
+                    break;
+                case IrOp::STORE:
+                    out << " @" << interner.name(in.name) << ", ";
+                    value(in.a);
+                    break;
+                case IrOp::CALL:
+                    out << " " << interner.name(in.name) << "(";
+                    if (in.name == SYM_PRINTS) {
+                        out << function.strings[in.imm];
+                    }
+                    for (int k = 0; k < in.count; k++) {
+                        value(function.args[in.imm + k]) << (k + 1 < in.count ? ", " : "");
+                    }
+                    out << ")";
+                    break;
+                case IrOp::JUMP:
+                    out << " L" << position[in.target];
+                    break;
+                case IrOp::BRANCH:
+                    out << " ";
+                    value(in.a) << ", L" << position[in.target] << ", L" << position[in.elseTarget];
+                    break;
+                case IrOp::HALT:
+                    break;
+                default:
+                    if (in.a != NO_VALUE) {
+                        out << " ";
+                        value(in.a);
+                    }
+                    if (in.b != NO_VALUE) {
+                        out << ", ";
+                        value(in.b);
+                    }
+                    break;
+            }
+            out << "\n";
+        }
+    }
+    out << "\n";
+}
+
+#endif
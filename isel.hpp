@@ -0,0 +1,672 @@
+#ifndef ISEL_HPP
+#define ISEL_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "asmWriter.hpp"
+#include "ir.hpp"
+#include "mips.hpp"
+#include "symbolTable.hpp"
+
+/*
+Instruction selector: turns the IR of a function into MIPS instructions on virtual
+registers, which the register allocator then maps to machine ones. Value v is
+virtual register FIRST_VIRTUAL + v, and the selector takes the registers after
+those for what it needs itself. Blocks are laid out in the order of the IR, the
+unreachable ones are left out, and a jump to the block laid out next is dropped.
+
+A temporary holding a constant isn't loaded where the IR makes it but right
+before each instruction that reads it, so a constant argument or return value
+takes one li straight into $a0-$a3 or $v0.
+
+A comparison right before the branch testing it becomes part of the branch, as
+one of the MIPS branches on two registers, a register and a constant, or a
+register and zero. The branch goes to whichever target isn't laid out next, with
+the condition inverted if that is the else target, so the other falls through. A
+branch on a constant is decided here, and becomes a jump or nothing.
+
+Multiplying by a constant with at most a few set bits is done with shifts and
+adds. Division by a constant uses shifts for a power of two and otherwise the
+upper word of a product with a magic number, and the remainder is derived from
+the quotient. Both round toward zero like div and rem, and dividing by 0 or -1
+is left to div and rem, which trap on 0 and where -1 is already cheap.
+
+The .data lines of the strings and of the globals are added to the data buffer,
+and the labels they need are numbered from labelNum, which the code shares with them.
+*/
+class InstructionSelector
+{
+    public:
+    size_t reduced = 0;     // Multiplications, divisions and remainders by constants made without mul, div and rem
+
+    InstructionSelector(Chunks& data, int& labelNum) : data(data), labelNum(labelNum) {}
+
+    // Returns the data label of a global variable, reserving its word on first use
+    int globalLabel(entry* variable) {
+        if (variable->location < 0) {
+            variable->location = labelNum++;
+            data.append("label").append(std::to_string(variable->location)).append(": .word 0\n");
+        }
+        return variable->location;
+    }
+
+    // Replaces code with the code of function, which starts with ENTER and whose
+    // virtual registers are below the returned one
+    Reg select(const IrFunction& function, std::vector<Instr>& code) {
+        this->function = &function;
+        this->code = &code;
+        code.clear();
+        compare = nullptr;
+        nextReg = FIRST_VIRTUAL + function.types.size();
+        lazy.assign(function.types.size(), false);
+        constants.resize(function.types.size());
+        outgoingArgs = 0;
+
+        // Number the labels of the blocks jumped to in layout order
+        findReachable(function, reached);
+        order.clear();
+        for (int block : function.layout) {
+            if (reached[block]) {
+                order.push_back(block);
+            }
+        }
+        labels.assign(function.blocks.size(), -1);
+        jumpedTo.assign(function.blocks.size(), false);
+        for (size_t i = 0; i < order.size(); i++) {
+            const IrInstr& last = function.code[function.blocks[order[i]].end - 1];
+            int next = i + 1 < order.size() ? order[i + 1] : -1;
+            if (last.op == IrOp::JUMP && last.target != next) {
+                jumpedTo[last.target] = true;
+            }
+            else if (last.op == IrOp::BRANCH) {
+                jumpedTo[last.target] = jumpedTo[last.target] || last.target != next;
+                jumpedTo[last.elseTarget] = jumpedTo[last.elseTarget] || last.elseTarget != next;
+            }
+        }
+        for (int block : order) {
+            if (jumpedTo[block]) {
+                labels[block] = labelNum++;
+            }
+        }
+
+        emit({.op = Op::ENTER});
+        // The first four parameters come in $a0-$a3, the caller left the others above the frame
+        for (int k = 0; k < function.numParams; k++) {
+            if (k < 4) {
+                emit({.op = Op::MOVE, .dst = reg(k), .src1 = A0 + k});
+            }
+            else {
+                emit({.op = Op::LW, .dst = reg(k), .src1 = FRAME, .imm = 4 * (k - 4)});
+            }
+        }
+        for (size_t i = 0; i < order.size(); i++) {
+            int block = order[i];
+            if (labels[block] >= 0) {
+                emit({.op = Op::LABEL, .imm = labels[block], .blockEdge = true});
+            }
+            int next = i + 1 < order.size() ? order[i + 1] : -1;
+            int end = function.blocks[block].end;
+            for (int k = function.blocks[block].begin; k < end; k++) {
+                const IrInstr& in = function.code[k];
+                if (k + 1 < end && isFused(in, function.code[k + 1])) {
+                    compare = &in;
+                    continue;
+                }
+                select(in, next);
+            }
+        }
+        code[0].imm = 4 * outgoingArgs;
+        return nextReg;
+    }
+
+    private:
+    Chunks& data;
+    int& labelNum;
+    const IrFunction* function = nullptr;
+    std::vector<Instr>* code = nullptr;
+    Reg nextReg = FIRST_VIRTUAL;
+    int outgoingArgs = 0;               // Most arguments past the fourth in a call of the function
+    std::vector<bool> reached;
+    std::vector<int> order;             // Blocks laid out
+    std::vector<bool> jumpedTo;
+    std::vector<int> labels;            // Label of each block jumped to
+    std::vector<bool> lazy;             // Temporaries holding a constant not loaded
+    std::vector<int> constants;
+    const IrInstr* compare = nullptr;   // Comparison left for the branch after it
+
+    static Reg reg(Value value) {
+        return FIRST_VIRTUAL + value;
+    }
+
+    Reg newReg() {
+        return nextReg++;
+    }
+
+    void emit(const Instr& in) {
+        code->push_back(in);
+    }
+
+    // Register of a value read by the next instruction
+    Reg use(Value value) {
+        if (lazy[value]) {
+            emit({.op = Op::LI, .dst = reg(value), .imm = constants[value]});
+        }
+        return reg(value);
+    }
+
+    // Puts a value into a machine register
+    void moveTo(Reg dst, Value value) {
+        if (lazy[value]) {
+            emit({.op = Op::LI, .dst = dst, .imm = constants[value]});
+        }
+        else {
+            emit({.op = Op::MOVE, .dst = dst, .src1 = reg(value)});
+        }
+    }
+
+    static bool isComparison(IrOp op) {
+        return op >= IrOp::EQ && op <= IrOp::GE;
+    }
+
+    // Whether in is a comparison only tested by branch, which comes right after it
+    bool isFused(const IrInstr& in, const IrInstr& branch) const {
+        return isComparison(in.op) && branch.op == IrOp::BRANCH && branch.a == in.dst && !function->variables[in.dst];
+    }
+
+    // The comparison true exactly when op is false
+    static IrOp inverse(IrOp op) {
+        switch (op) {
+            case IrOp::EQ: return IrOp::NE;
+            case IrOp::NE: return IrOp::EQ;
+            case IrOp::LT: return IrOp::GE;
+            case IrOp::LE: return IrOp::GT;
+            case IrOp::GT: return IrOp::LE;
+            default: return IrOp::LT;
+        }
+    }
+
+    // The comparison of b with a that op is of a with b
+    static IrOp mirror(IrOp op) {
+        switch (op) {
+            case IrOp::LT: return IrOp::GT;
+            case IrOp::LE: return IrOp::GE;
+            case IrOp::GT: return IrOp::LT;
+            case IrOp::GE: return IrOp::LE;
+            default: return op;
+        }
+    }
+
+    static bool evaluate(IrOp op, int a, int b) {
+        switch (op) {
+            case IrOp::EQ: return a == b;
+            case IrOp::NE: return a != b;
+            case IrOp::LT: return a < b;
+            case IrOp::LE: return a <= b;
+            case IrOp::GT: return a > b;
+            default: return a >= b;
+        }
+    }
+
+    static Op branchOp(IrOp op) {
+        switch (op) {
+            case IrOp::EQ: return Op::BEQ;
+            case IrOp::NE: return Op::BNE;
+            case IrOp::LT: return Op::BLT;
+            case IrOp::LE: return Op::BLE;
+            case IrOp::GT: return Op::BGT;
+            default: return Op::BGE;
+        }
+    }
+
+    static Op zeroBranchOp(IrOp op) {
+        switch (op) {
+            case IrOp::EQ: return Op::BEQ;
+            case IrOp::NE: return Op::BNE;
+            case IrOp::LT: return Op::BLTZ;
+            case IrOp::LE: return Op::BLEZ;
+            case IrOp::GT: return Op::BGTZ;
+            default: return Op::BGEZ;
+        }
+    }
+
+    void jump(int block, int next) {
+        if (block != next) {
+            emit({.op = Op::B, .imm = labels[block], .blockEdge = true});
+        }
+    }
+
+    // A branch, on the comparison left for it or on a boolean compared with 0
+    void branch(const IrInstr& in, int next) {
+        IrOp op = IrOp::NE;
+        Value left = in.a, right = NO_VALUE;    // NO_VALUE stands for 0 here
+        if (compare != nullptr) {
+            op = compare->op;
+            left = compare->a;
+            right = compare->b;
+            compare = nullptr;
+        }
+        int target = in.target, other = in.elseTarget;
+        if (target == next) {
+            std::swap(target, other);
+            op = inverse(op);
+        }
+        auto isConstant = [this](Value value) {
+            return value == NO_VALUE || lazy[value];
+        };
+        auto constant = [this](Value value) {
+            return value == NO_VALUE ? 0 : constants[value];
+        };
+        if (isConstant(left) && isConstant(right)) {
+            jump(evaluate(op, constant(left), constant(right)) ? target : other, next);
+            return;
+        }
+        if (isConstant(left)) {
+            std::swap(left, right);
+            op = mirror(op);
+        }
+        if (!isConstant(right)) {
+            emit({.op = branchOp(op), .src1 = use(left), .src2 = use(right), .imm = labels[target], .blockEdge = true});
+        }
+        else if (constant(right) == 0) {
+            Reg zero = op == IrOp::EQ || op == IrOp::NE ? ZERO : NO_REG;
+            emit({.op = zeroBranchOp(op), .src1 = use(left), .src2 = zero, .imm = labels[target], .blockEdge = true});
+        }
+        else {
+            emit({.op = branchOp(op), .src1 = use(left), .imm = labels[target], .constant = constant(right), .blockEdge = true});
+        }
+        jump(other, next);
+    }
+
+    static Op binaryOp(IrOp op) {
+        switch (op) {
+            case IrOp::ADD: return Op::ADD;
+            case IrOp::SUB: return Op::SUB;
+            case IrOp::MUL: return Op::MUL;
+            case IrOp::DIV: return Op::DIV;
+            case IrOp::REM: return Op::REM;
+            case IrOp::EQ: return Op::SEQ;
+            case IrOp::NE: return Op::SNE;
+            case IrOp::LT: return Op::SLT;
+            case IrOp::LE: return Op::SLE;
+            case IrOp::GT: return Op::SGT;
+            case IrOp::GE: return Op::SGE;
+            case IrOp::AND: return Op::AND;
+            default: return Op::OR;
+        }
+    }
+
+    // Most shifts, adds and subtractions a multiplication by a constant is made of
+    static const int MAX_MULTIPLY_STEPS = 3;
+
+    static bool isPowerOfTwo(uint32_t n) {
+        return n != 0 && (n & (n - 1)) == 0;
+    }
+
+    static int exponent(uint32_t powerOfTwo) {
+        int k = 0;
+        while (powerOfTwo >>= 1) {
+            k++;
+        }
+        return k;
+    }
+
+    static uint32_t magnitude(int n) {
+        return n < 0 ? 0u - (uint32_t)n : (uint32_t)n;
+    }
+
+    // dst = src * constant with shifts, adds and subtractions, modulo 2^32 like
+    // mul. Emits nothing and returns false when it takes too many of them.
+    bool multiply(Reg dst, Reg src, int constant) {
+        bool negative = constant < 0;
+        uint32_t m = magnitude(constant);
+        if (m == 0) {
+            emit({.op = Op::LI, .dst = dst, .imm = 0});
+            return true;
+        }
+        if (isPowerOfTwo(m)) {
+            Reg shifted = src;
+            if (m > 1) {
+                shifted = negative ? newReg() : dst;
+                emit({.op = Op::SLL, .dst = shifted, .src1 = src, .imm = exponent(m)});
+            }
+            if (negative) {
+                emit({.op = Op::SUBU, .dst = dst, .src1 = ZERO, .src2 = shifted});
+            }
+            else if (m == 1) {
+                emit({.op = Op::MOVE, .dst = dst, .src1 = src});
+            }
+            return true;
+        }
+        // m is 2^a + 2^b or 2^a - 2^b, with a > b
+        uint32_t low = m & (0u - m);
+        bool sum = isPowerOfTwo(m - low);
+        if (!sum && !isPowerOfTwo(m + low)) {
+            return false;
+        }
+        int a = exponent(sum ? m - low : m + low), b = exponent(low);
+        if ((b > 0 ? 3 : 2) + (sum && negative ? 1 : 0) > MAX_MULTIPLY_STEPS) {
+            return false;
+        }
+        Reg high = newReg();
+        emit({.op = Op::SLL, .dst = high, .src1 = src, .imm = a});
+        Reg lowPart = src;
+        if (b > 0) {
+            lowPart = newReg();
+            emit({.op = Op::SLL, .dst = lowPart, .src1 = src, .imm = b});
+        }
+        if (!sum) {
+            // -(2^a - 2^b) is 2^b - 2^a
+            emit({.op = Op::SUBU, .dst = dst, .src1 = negative ? lowPart : high, .src2 = negative ? high : lowPart});
+        }
+        else if (!negative) {
+            emit({.op = Op::ADDU, .dst = dst, .src1 = high, .src2 = lowPart});
+        }
+        else {
+            Reg total = newReg();
+            emit({.op = Op::ADDU, .dst = total, .src1 = high, .src2 = lowPart});
+            emit({.op = Op::SUBU, .dst = dst, .src1 = ZERO, .src2 = total});
+        }
+        return true;
+    }
+
+    // The register added to src before shifting it right by k to divide it by
+    // 2^k toward zero: 2^k - 1 when src is negative, 0 otherwise
+    Reg bias(Reg src, int k) {
+        Reg sign = src;
+        if (k > 1) {
+            sign = newReg();
+            emit({.op = Op::SRA, .dst = sign, .src1 = src, .imm = 31});
+        }
+        Reg added = newReg();
+        emit({.op = Op::SRL, .dst = added, .src1 = sign, .imm = 32 - k});
+        return added;
+    }
+
+    struct Magic {
+        int multiplier;
+        int shift;
+    };
+
+    // Magic number of a divisor that isn't 0, 1, -1 or a power of two, as in
+    // Hacker's Delight: the smallest shift for which some multiplier gives
+    // the quotient of every dividend from the upper word of their product.
+    static Magic magic(int divisor) {
+        const uint32_t two31 = 0x80000000u;
+        uint32_t ad = magnitude(divisor);
+        uint32_t t = two31 + ((uint32_t)divisor >> 31);
+        uint32_t anc = t - 1 - t % ad;          // Largest dividend with remainder ad - 1
+        int p = 31;
+        uint32_t q1 = two31 / anc, r1 = two31 - q1 * anc;
+        uint32_t q2 = two31 / ad, r2 = two31 - q2 * ad;
+        uint32_t delta;
+        do {
+            p++;
+            q1 *= 2;
+            r1 *= 2;
+            if (r1 >= anc) {
+                q1++;
+                r1 -= anc;
+            }
+            q2 *= 2;
+            r2 *= 2;
+            if (r2 >= ad) {
+                q2++;
+                r2 -= ad;
+            }
+            delta = ad - r2;
+        } while (q1 < delta || (q1 == delta && r1 == 0));
+        uint32_t multiplier = q2 + 1;
+        return {(int)(divisor < 0 ? 0u - multiplier : multiplier), p - 32};
+    }
+
+    // dst = src / divisor, rounded toward zero, for a divisor other than 0 and -1
+    void divide(Reg dst, Reg src, int divisor) {
+        uint32_t m = magnitude(divisor);
+        if (m == 1) {
+            emit({.op = Op::MOVE, .dst = dst, .src1 = src});
+            return;
+        }
+        if (isPowerOfTwo(m)) {
+            int k = exponent(m);
+            Reg biased = newReg();
+            emit({.op = Op::ADDU, .dst = biased, .src1 = src, .src2 = bias(src, k)});
+            Reg quotient = divisor < 0 ? newReg() : dst;
+            emit({.op = Op::SRA, .dst = quotient, .src1 = biased, .imm = k});
+            if (divisor < 0) {
+                emit({.op = Op::SUBU, .dst = dst, .src1 = ZERO, .src2 = quotient});
+            }
+            return;
+        }
+        Magic number = magic(divisor);
+        Reg multiplier = newReg();
+        emit({.op = Op::LI, .dst = multiplier, .imm = number.multiplier});
+        emit({.op = Op::MULT, .src1 = src, .src2 = multiplier});
+        Reg quotient = newReg();
+        emit({.op = Op::MFHI, .dst = quotient});
+        // The multiplier didn't fit with its sign, the product lacks src times 2^32
+        if ((divisor > 0 && number.multiplier < 0) || (divisor < 0 && number.multiplier > 0)) {
+            Reg corrected = newReg();
+            emit({.op = divisor > 0 ? Op::ADDU : Op::SUBU, .dst = corrected, .src1 = quotient, .src2 = src});
+            quotient = corrected;
+        }
+        if (number.shift > 0) {
+            Reg shifted = newReg();
+            emit({.op = Op::SRA, .dst = shifted, .src1 = quotient, .imm = number.shift});
+            quotient = shifted;
+        }
+        // The shift rounds down, adding 1 to a negative quotient rounds it toward zero
+        Reg sign = newReg();
+        emit({.op = Op::SRL, .dst = sign, .src1 = quotient, .imm = 31});
+        emit({.op = Op::ADDU, .dst = dst, .src1 = quotient, .src2 = sign});
+    }
+
+    // dst = src % divisor, with the sign of src, for a divisor other than 0 and -1
+    void remainder(Reg dst, Reg src, int divisor) {
+        uint32_t m = magnitude(divisor);
+        if (m == 1) {
+            emit({.op = Op::LI, .dst = dst, .imm = 0});
+            return;
+        }
+        if (isPowerOfTwo(m)) {
+            // The low bits of src + bias, less the bias
+            Reg added = bias(src, exponent(m));
+            Reg biased = newReg();
+            emit({.op = Op::ADDU, .dst = biased, .src1 = src, .src2 = added});
+            Reg masked = newReg();
+            if (m - 1 <= 0xffff) {
+                emit({.op = Op::ANDI, .dst = masked, .src1 = biased, .imm = (int)(m - 1)});
+            }
+            else {
+                Reg mask = newReg();
+                emit({.op = Op::LI, .dst = mask, .imm = (int)(m - 1)});
+                emit({.op = Op::AND, .dst = masked, .src1 = biased, .src2 = mask});
+            }
+            emit({.op = Op::SUBU, .dst = dst, .src1 = masked, .src2 = added});
+            return;
+        }
+        Reg quotient = newReg();
+        divide(quotient, src, divisor);
+        Reg product = newReg();
+        if (!multiply(product, quotient, divisor)) {
+            Reg constant = newReg();
+            emit({.op = Op::LI, .dst = constant, .imm = divisor});
+            emit({.op = Op::MUL, .dst = product, .src1 = quotient, .src2 = constant});
+        }
+        emit({.op = Op::SUBU, .dst = dst, .src1 = src, .src2 = product});
+    }
+
+    // A multiplication, division or remainder of a register by a constant,
+    // without mul, div or rem. Returns false when it is left to them.
+    bool reduce(const IrInstr& in) {
+        Value operand = in.a, constant = in.b;
+        if (in.op == IrOp::MUL && lazy[operand]) {
+            std::swap(operand, constant);
+        }
+        if (lazy[operand] || !lazy[constant]) {
+            return false;
+        }
+        int c = constants[constant];
+        bool done;
+        if (in.op == IrOp::MUL) {
+            done = multiply(reg(in.dst), reg(operand), c);
+        }
+        else if (c == 0 || c == -1) {
+            done = false;
+        }
+        else if (in.op == IrOp::DIV) {
+            divide(reg(in.dst), reg(operand), c);
+            done = true;
+        }
+        else {
+            remainder(reg(in.dst), reg(operand), c);
+            done = true;
+        }
+        reduced += done;
+        return done;
+    }
+
+    // Selects one IR instruction. next is the block laid out after the current one.
+    void select(const IrInstr& in, int next) {
+        switch (in.op) {
+        case IrOp::CONST:
+            if (function->variables[in.dst]) {
+                emit({.op = Op::LI, .dst = reg(in.dst), .imm = in.imm});
+            }
+            else {
+                lazy[in.dst] = true;
+                constants[in.dst] = in.imm;
+            }
+            break;
+        case IrOp::COPY:
+            moveTo(reg(in.dst), in.a);
+            break;
+        case IrOp::LOAD:
+            emit({.op = Op::LWL, .dst = reg(in.dst), .imm = globalLabel(in.variable)});
+            break;
+        case IrOp::STORE:
+            emit({.op = Op::SWL, .src1 = use(in.a), .imm = globalLabel(in.variable)});
+            break;
+        case IrOp::NEG:
+            emit({.op = Op::NEG, .dst = reg(in.dst), .src1 = use(in.a)});
+            break;
+        case IrOp::NOT:
+            emit({.op = Op::NOT, .dst = reg(in.dst), .src1 = use(in.a)});
+            break;
+        case IrOp::CALL:
+            if (in.name == SYM_GETCHAR || in.name == SYM_PRINTB || in.name == SYM_PRINTC ||
+                in.name == SYM_PRINTI || in.name == SYM_PRINTS) {
+                library(in);
+            }
+            else {
+                call(in);
+            }
+            break;
+        case IrOp::JUMP:
+            jump(in.target, next);
+            break;
+        case IrOp::BRANCH:
+            branch(in, next);
+            break;
+        case IrOp::RET:
+            if (function->isMain) {
+                // The exit code comes right after main
+                if (next >= 0) {
+                    emit({.op = Op::J});
+                }
+                break;
+            }
+            if (in.a != NO_VALUE) {
+                moveTo(V0, in.a);
+            }
+            emit({.op = Op::LEAVE});
+            emit({.op = Op::JR, .src1 = RA});
+            break;
+        case IrOp::HALT:
+            if (!function->isMain || next >= 0) {
+                emit({.op = Op::J});
+            }
+            break;
+        default: {
+            if ((in.op == IrOp::MUL || in.op == IrOp::DIV || in.op == IrOp::REM) && reduce(in)) {
+                break;
+            }
+            Reg left = use(in.a);
+            Reg right = use(in.b);
+            emit({.op = binaryOp(in.op), .dst = reg(in.dst), .src1 = left, .src2 = right});
+            break;
+        }
+        }
+    }
+
+    // A call of a function of the program. The arguments past the fourth go to
+    // the bottom of the frame, where the callee finds them.
+    void call(const IrInstr& in) {
+        const Value* args = function->args.data() + in.imm;
+        for (int k = 4; k < in.count; k++) {
+            emit({.op = Op::SW, .src1 = use(args[k]), .src2 = SP, .imm = 4 * (k - 4)});
+        }
+        outgoingArgs = std::max(outgoingArgs, in.count - 4);
+        for (int k = 0; k < in.count && k < 4; k++) {
+            moveTo(A0 + k, args[k]);
+        }
+        emit({.op = Op::JAL, .name = in.name});
+        if (in.dst != NO_VALUE) {
+            emit({.op = Op::MOVE, .dst = reg(in.dst), .src1 = V0});
+        }
+    }
+
+    // A call of a library function, made with syscalls. The argument goes to $a0
+    // first, right after the instruction computing it.
+    void library(const IrInstr& in) {
+        const Value* args = function->args.data() + in.imm;
+        if (in.name == SYM_GETCHAR) {
+            data.append("label").append(std::to_string(labelNum)).append(": .asciiz \"Enter an int now:\"\n");
+            emit({.op = Op::LI, .dst = V0, .imm = 4});
+            emit({.op = Op::LA, .dst = A0, .imm = labelNum});
+            emit({.op = Op::SYSCALL});
+            emit({.op = Op::LI, .dst = V0, .imm = 5});
+            emit({.op = Op::SYSCALL});
+            emit({.op = Op::MOVE, .dst = reg(in.dst), .src1 = V0});
+            labelNum++;
+        }
+        else if (in.name == SYM_PRINTB) {
+            data.append("label").append(std::to_string(labelNum)).append(": .asciiz \"true\"\n");
+            data.append("label").append(std::to_string(labelNum+1)).append(": .asciiz \"false\"\n");
+            moveTo(A0, args[0]);
+            emit({.op = Op::LI, .dst = V0, .imm = 4});
+            //Print out the branching if else statement for the printb function
+            emit({.op = Op::BEQ, .src1 = ZERO, .src2 = A0, .imm = labelNum+2});
+            emit({.op = Op::LA, .dst = A0, .imm = labelNum});
+            emit({.op = Op::SYSCALL});
+            emit({.op = Op::B, .imm = labelNum+3});
+            emit({.op = Op::LABEL, .imm = labelNum+2});
+            emit({.op = Op::LA, .dst = A0, .imm = labelNum+1});
+            emit({.op = Op::SYSCALL});
+            emit({.op = Op::LABEL, .imm = labelNum+3});
+            labelNum+=4;
+        }
+        else if (in.name == SYM_PRINTC) {
+            data.append("label").append(std::to_string(labelNum)).append(": .asciiz \"\"\n");
+            emit({.op = Op::LI, .dst = V0, .imm = 4});
+            emit({.op = Op::LA, .dst = A0, .imm = labelNum});
+            emit({.op = Op::SYSCALL});
+            labelNum++;
+        }
+        else if (in.name == SYM_PRINTI) {
+            moveTo(A0, args[0]);
+            emit({.op = Op::LI, .dst = V0, .imm = 1});
+            emit({.op = Op::SYSCALL});
+        }
+        else {
+            data.append("label").append(std::to_string(labelNum)).append(": .asciiz ").append(function->strings[in.imm]).append("\n");
+            emit({.op = Op::LI, .dst = V0, .imm = 4});
+            emit({.op = Op::LA, .dst = A0, .imm = labelNum});
+            emit({.op = Op::SYSCALL});
+            labelNum++;
+        }
+    }
+};
+
+#endif
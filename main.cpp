@@ -4,12 +4,24 @@
 
 #include <cstdlib>
 #include <cerrno>
+#include <climits>
 #include <cstring>
 #include <fstream>
 #include "vector"
 #include "scanner.hpp"
+#include "simdLexer.hpp"
 #include "parser.hh"
 #include "codeGen.cpp"
+#include "constFold.hpp"
+#include "deadCode.hpp"
+
+// Reads the whole of text as a number from 0 to max
+static bool parseCount(const char* text, long max, long& value) {
+    char *end;
+    errno = 0;
+    value = strtol(text, &end, 10);
+    return end != text && *end == '\0' && errno == 0 && value >= 0 && value <= max;
+}
 
 int main(int argc, char **argv) {
 
@@ -17,18 +29,117 @@ int main(int argc, char **argv) {
 
     std::ifstream file;
 
+    // Source file mapped into memory when --mmap is given
+    SourceFile source;
+
     extern AST* root;
 
     extern char* filename;
-    
-    filename = argv[1];
 
-    if (argc != 2) {
-        std::cerr << "You must provide exactly 1 command line argument: The file path you wish to parse." << std::endl;
+    // All AST nodes for this compilation live in this arena
+    Arena arena;
+    AST::arena = &arena;
+
+    bool printStats = false, useMmap = false, useSimdLexer = false, lexOnly = false, dumpTokens = false, printTree = true, foldConstants = true;
+    bool removeDeadCode = true, reportInlining = false;
+    filename = nullptr;
+    int numFiles = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--stats") == 0) {
+            printStats = true;
+        }
+        else if (strcmp(argv[i], "--mmap") == 0) {
+            useMmap = true;
+        }
+        else if (strcmp(argv[i], "--lexer=simd") == 0) {
+            useSimdLexer = true;
+        }
+        else if (strcmp(argv[i], "--lexer=flex") == 0) {
+            useSimdLexer = false;
+        }
+        else if (strcmp(argv[i], "--sema=fused") == 0) {
+            semaMode = SemaMode::FUSED;
+        }
+        else if (strcmp(argv[i], "--sema=parallel") == 0) {
+            semaMode = SemaMode::PARALLEL;
+        }
+        else if (strcmp(argv[i], "--sema=passes") == 0) {
+            semaMode = SemaMode::PASSES;
+        }
+        else if (strncmp(argv[i], "--threads=", 10) == 0) {
+            long threads;
+            if (!parseCount(argv[i] + 10, MAX_SEMA_THREADS, threads)) {
+                std::cerr << "Invalid " << argv[i] << ": the number of threads must be from 1 to " << MAX_SEMA_THREADS
+                          << ", or 0 for one per core." << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            semaThreads = threads;
+        }
+        else if (strcmp(argv[i], "--lex-only") == 0) {
+            lexOnly = true;
+        }
+        else if (strcmp(argv[i], "--dump-tokens") == 0) {
+            dumpTokens = true;
+        }
+        else if (strcmp(argv[i], "--no-print") == 0) {
+            printTree = false;
+        }
+        else if (strcmp(argv[i], "--no-fold") == 0) {
+            foldConstants = false;
+        }
+        else if (strcmp(argv[i], "--no-dce") == 0) {
+            removeDeadCode = false;
+        }
+        else if (strcmp(argv[i], "--no-peephole") == 0) {
+            usePeephole = false;
+        }
+        else if (strcmp(argv[i], "--dump-ir") == 0) {
+            writeIr = true;
+        }
+        else if (strcmp(argv[i], "--no-inline") == 0) {
+            useInliner = false;
+        }
+        else if (strncmp(argv[i], "--inline-threshold=", 19) == 0) {
+            long threshold;
+            if (!parseCount(argv[i] + 19, INT_MAX, threshold)) {
+                std::cerr << "Invalid " << argv[i] << ": the threshold must be a number of instructions from 0 to " << INT_MAX
+                          << "." << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            inliner.threshold = threshold;
+        }
+        else if (strncmp(argv[i], "--inline-single-threshold=", 26) == 0) {
+            long threshold;
+            if (!parseCount(argv[i] + 26, INT_MAX, threshold)) {
+                std::cerr << "Invalid " << argv[i] << ": the threshold must be a number of instructions from 0 to " << INT_MAX
+                          << "." << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            inliner.singleThreshold = threshold;
+        }
+        else if (strcmp(argv[i], "--inline-report") == 0) {
+            reportInlining = true;
+        }
+        else {
+            filename = argv[i];
+            numFiles++;
+        }
+    }
+
+    if (numFiles != 1) {
+        std::cerr << "You must provide exactly 1 file argument: The file path you wish to parse." << std::endl;
+        std::cerr << "Usage: " << argv[0] << " [--stats] [--mmap] [--lexer=flex|simd] [--sema=passes|fused|parallel] [--threads=N] [--lex-only] [--dump-tokens] [--no-print] [--no-fold] [--no-dce] [--no-peephole] [--dump-ir] [--no-inline] [--inline-threshold=N] [--inline-single-threshold=N] [--inline-report] file" << std::endl;
         exit(EXIT_FAILURE);
     }
+    else if (useMmap) {
+        if (!source.open(filename))
+        {
+            std::cerr << "Error: " << strerror(errno) << "\n";
+            return EXIT_FAILURE;
+        }
+    }
     else {
-        file.open(argv[1]);
+        file.open(filename);
 
         if (!file.good())
         {
@@ -38,7 +149,48 @@ int main(int argc, char **argv) {
 
         input = &file;
         }
-    auto lexer = createLexer(input);
+    auto lexStart = std::chrono::steady_clock::now();
+    std::unique_ptr<JCC::Lexer> lexer;
+    if (useSimdLexer) {
+        lexer = useMmap ? createSimdLexer(source) : createSimdLexer(input);
+    }
+    else {
+        lexer = useMmap ? createLexer(source) : createLexer(input);
+    }
+
+    // Scanner throughput benchmark: run the lexer over the whole file and stop.
+    // --dump-tokens prints every token instead, to compare what the two lexers see.
+    if (lexOnly || dumpTokens) {
+        JCC::Parser::semantic_type value;
+        JCC::Parser::location_type loc;
+        long tokens = 0;
+        int token;
+        while ((token = lexer->yylex(&value, &loc)) != 0) {
+            tokens++;
+            if (dumpTokens) {
+                std::cout << lexer->lineno() << " " << loc << " " << token;
+                if (token == JCC::Parser::token::T_ID) {
+                    std::cout << " " << interner.name(value.sym);
+                }
+                else if (token == JCC::Parser::token::T_NUM) {
+                    std::cout << " " << value.ival;
+                }
+                else if (token == JCC::Parser::token::T_STRING) {
+                    std::cout << " " << value.str;
+                }
+                std::cout << "\n";
+            }
+        }
+        if (dumpTokens) {
+            std::cout << lexer->lineno() << " " << loc << " end of file" << std::endl;
+            return 0;
+        }
+        double millis = elapsedMillis(lexStart);
+        double megabytes = (useMmap ? source.size() : static_cast<size_t>(std::ifstream(filename, std::ios::ate | std::ios::binary).tellg())) / 1e6;
+        std::cerr << (useSimdLexer ? "simd" : "flex") << " lexer: " << tokens << " tokens, " << megabytes << " MB in "
+                  << millis << " ms (" << megabytes / (millis / 1000) << " MB/s)" << std::endl;
+        return 0;
+    }
     auto parser = std::make_unique<JCC::Parser>(lexer);
    
     if( parser->parse() != 0 )
@@ -47,15 +199,85 @@ int main(int argc, char **argv) {
         if (file.is_open()) file.close();
         return 1;
     }
-    root->reverseChildren();
+    if (printStats) {
+        std::cerr << "Parse: " << elapsedMillis(lexStart) << " ms" << std::endl;
+        int lines = lexer->lineno();
+        std::cerr << "AST: " << AST::numNodes << " nodes, " << AST::nodeBytes << " bytes, "
+                  << (double)AST::nodeBytes / (lines > 0 ? lines : 1) << " bytes/line over " << lines << " line(s)" << std::endl;
+        std::cerr << "Arena: " << arena.numAllocations() << " allocations, " << arena.numBytes() << " bytes in "
+                  << arena.numChunks() << " chunk(s), counting child arrays and string copies" << std::endl;
+    }
     root = semanticAnalyzer(root);
+    if (printStats) {
+        for (auto& pass : passTimes) {
+            std::cerr << pass.first << ": " << pass.second << " ms" << std::endl;
+        }
+        size_t entries = symbols.size(), bytes = symbols.memoryUsed();
+        for (auto& table : threadSymbols) {
+            entries += table->size();
+            bytes += table->memoryUsed();
+        }
+        std::cerr << "Symbol table: " << entries << " entries in " << symbols.numScopes() << " scopes, "
+                  << bytes << " bytes" << std::endl;
+    }
     if (errors > 0) {
         std::cerr << errors << " error(s) found. Exiting." << std::endl;
         exit(EXIT_FAILURE);
     }
 
+    if (printTree) {
+        root->Print();
+    }
+
+    // Replace constant expressions and uses of constant locals by their values
+    auto start = std::chrono::steady_clock::now();
+    if (foldConstants) {
+        ConstantFolder folder;
+        folder.run(root);
+        if (printStats) {
+            std::cerr << "Constant folding: " << folder.folded << " operators folded, " << folder.propagated
+                      << " variable uses replaced in " << elapsedMillis(start) << " ms" << std::endl;
+        }
+    }
+
+    // Drop the functions main never calls and the statements that can't run
+    start = std::chrono::steady_clock::now();
+    if (removeDeadCode) {
+        DeadCodeEliminator eliminator;
+        eliminator.run(root);
+        if (printStats) {
+            std::cerr << "Dead code: " << eliminator.functionsRemoved << " unreachable functions, " << eliminator.statementsRemoved
+                      << " unreachable statements and " << eliminator.branchesRemoved << " constant branches removed in "
+                      << elapsedMillis(start) << " ms" << std::endl;
+        }
+    }
+
     // Generate the MIPS file from the AST
+    start = std::chrono::steady_clock::now();
     generateCode(root);
+    if (reportInlining) {
+        for (const Inliner::Inlined& call : inliner.inlined) {
+            std::cerr << "Inlined " << interner.name(call.callee) << " into " << interner.name(call.caller) << ": "
+                      << (call.onlyCall ? "only call" : "leaf") << ", " << call.size << " instructions" << std::endl;
+        }
+    }
+    if (printStats) {
+        std::cerr << "Code generation: " << elapsedMillis(start) << " ms, " << asmWriter.memoryUsed() << " bytes of output buffers" << std::endl;
+        if (useInliner) {
+            std::cerr << "Inlining: " << inliner.inlined.size() << " calls inlined, " << inliner.functionsRemoved
+                      << " functions removed" << std::endl;
+        }
+        std::cerr << "Strength reduction: " << selector.reduced << " multiplications, divisions and remainders by constants" << std::endl;
+        std::cerr << "Register allocation: " << regAllocator.intervals << " live intervals, " << regAllocator.spilled << " spilled, "
+                  << regAllocator.spillLoads << " spill loads, " << regAllocator.spillStores << " spill stores" << std::endl;
+        if (usePeephole) {
+            std::cerr << "Peephole:";
+            for (size_t rule = 0; rule < peephole.numRules(); rule++) {
+                std::cerr << (rule > 0 ? ", " : " ") << peephole.ruleName(rule) << " " << peephole.hits[rule];
+            }
+            std::cerr << std::endl;
+        }
+    }
 
     return 0;
 }
\ No newline at end of file
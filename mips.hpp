@@ -0,0 +1,226 @@
+#ifndef MIPS_HPP
+#define MIPS_HPP
+
+#include <cstdint>
+#include <string>
+#include "intern.hpp"
+
+// Registers are numbered as on the machine from 0 to 31. FRAME stands for the
+// $sp a function was called with, above which the caller left the arguments
+// past the fourth. Offsets from it are only final once the register allocator
+// knows the size of the frame. The numbers from FIRST_VIRTUAL on are virtual
+// registers, mapped to machine ones by the register allocator.
+typedef int Reg;
+const Reg NO_REG = -1;
+const Reg ZERO = 0, V0 = 2, V1 = 3, A0 = 4, T0 = 8, S0 = 16, T8 = 24, T9 = 25, SP = 29, RA = 31;
+const Reg FRAME = 32;
+const Reg FIRST_VIRTUAL = 33;
+
+enum class Op : uint8_t {
+    LABEL,          // labelN:
+    LI,             // li dst, imm
+    LA,             // la dst, labelN
+    MOVE,           // move dst, src1
+    LW,             // lw dst, imm(src1)
+    SW,             // sw src1, imm(src2)
+    LWL,            // lw dst, labelN, a global variable
+    SWL,            // sw src1, labelN
+    ADD, SUB, MUL, DIV, REM, SEQ, SNE, SGE, SLE, SGT, SLT, AND, OR,    // op dst, src1, src2
+    NEG,            // neg dst, src1
+    NOT,            // xori dst, src1, 1, the ! of a boolean
+    ADDI, SUBI,     // add/sub dst, src1, imm
+    SLL, SRL, SRA, ANDI,        // op dst, src1, imm
+    ADDU, SUBU,     // op dst, src1, src2, wrapping around instead of trapping on overflow
+    MFHI,           // mfhi dst, the upper word of the product of the last mult
+    MULT,           // mult src1, src2
+    BEQ,            // beq src1, src2, labelN
+    // op src1, src2, labelN, or op src1, constant, labelN when src2 is NO_REG
+    BNE, BLT, BLE, BGT, BGE,
+    BLTZ, BLEZ, BGTZ, BGEZ,     // op src1, labelN, comparing with zero
+    B,              // b labelN
+    J,              // j end, the exit at the end of main
+    JAL,            // jal name
+    JR,             // jr src1
+    SYSCALL,
+    // Set up the frame of a function and tear it down again: imm bytes at the
+    // bottom for the arguments of calls past the fourth, then the spill slots
+    // and the callee-saved registers the function uses. The register allocator
+    // turns them into the sub/add on $sp and the saves and restores.
+    ENTER, LEAVE
+};
+
+struct Instr {
+    Op op;
+    Reg dst = NO_REG;
+    Reg src1 = NO_REG;
+    Reg src2 = NO_REG;
+    int imm = 0;                // Immediate, offset or label number
+    int constant = 0;           // Immediate a branch compares src1 with
+    Symbol name = NO_SYMBOL;    // Function called by jal
+    bool blockEdge = false;     // A label starting or a branch ending the code of an IR block
+};
+
+inline bool isVirtual(Reg reg) {
+    return reg >= FIRST_VIRTUAL;
+}
+
+// Branches to label imm or falls through to the next instruction
+inline bool isConditionalBranch(Op op) {
+    return op >= Op::BEQ && op <= Op::BGEZ;
+}
+
+// Ends a basic block: nothing after it runs unless it is jumped to or the branch isn't taken
+inline bool isBranch(Op op) {
+    return isConditionalBranch(op) || op == Op::B || op == Op::J || op == Op::JR;
+}
+
+inline const char* regName(Reg reg) {
+    static const char* const names[] = {
+        "$0", "$at", "$v0", "$v1", "$a0", "$a1", "$a2", "$a3",
+        "$t0", "$t1", "$t2", "$t3", "$t4", "$t5", "$t6", "$t7",
+        "$s0", "$s1", "$s2", "$s3", "$s4", "$s5", "$s6", "$s7",
+        "$t8", "$t9", "$k0", "$k1", "$gp", "$sp", "$fp", "$ra", "$sp"};
+    return reg >= 0 && reg <= FRAME ? names[reg] : "$?";
+}
+
+inline const char* opName(Op op) {
+    switch (op) {
+        case Op::LI: return "li";
+        case Op::LA: return "la";
+        case Op::MOVE: return "move";
+        case Op::LW: case Op::LWL: return "lw";
+        case Op::SW: case Op::SWL: return "sw";
+        case Op::ADD: case Op::ADDI: return "add";
+        case Op::SUB: case Op::SUBI: return "sub";
+        case Op::MUL: return "mul";
+        case Op::DIV: return "div";
+        case Op::REM: return "rem";
+        case Op::SEQ: return "seq";
+        case Op::SNE: return "sne";
+        case Op::SGE: return "sge";
+        case Op::SLE: return "sle";
+        case Op::SGT: return "sgt";
+        case Op::SLT: return "slt";
+        case Op::AND: return "and";
+        case Op::OR: return "or";
+        case Op::NEG: return "neg";
+        case Op::NOT: return "xori";
+        case Op::SLL: return "sll";
+        case Op::SRL: return "srl";
+        case Op::SRA: return "sra";
+        case Op::ANDI: return "andi";
+        case Op::ADDU: return "addu";
+        case Op::SUBU: return "subu";
+        case Op::MFHI: return "mfhi";
+        case Op::MULT: return "mult";
+        case Op::BEQ: return "beq";
+        case Op::BNE: return "bne";
+        case Op::BLT: return "blt";
+        case Op::BLE: return "ble";
+        case Op::BGT: return "bgt";
+        case Op::BGE: return "bge";
+        case Op::BLTZ: return "bltz";
+        case Op::BLEZ: return "blez";
+        case Op::BGTZ: return "bgtz";
+        case Op::BGEZ: return "bgez";
+        case Op::B: return "b";
+        case Op::J: return "j";
+        case Op::JAL: return "jal";
+        case Op::JR: return "jr";
+        case Op::SYSCALL: return "syscall";
+        default: return "";
+    }
+}
+
+// Appends the assembly line of an instruction to out
+inline void writeInstr(std::string& out, const Instr& in) {
+    if (in.op == Op::LABEL) {
+        out.append("label").append(std::to_string(in.imm)).append(":\n");
+        return;
+    }
+    out.append(opName(in.op));
+    switch (in.op) {
+        case Op::LI:
+            out.append(" ").append(regName(in.dst)).append(", ").append(std::to_string(in.imm));
+            break;
+        case Op::LA:
+            out.append(" ").append(regName(in.dst)).append(", label").append(std::to_string(in.imm));
+            break;
+        case Op::MOVE:
+        case Op::NEG:
+            out.append(" ").append(regName(in.dst)).append(", ").append(regName(in.src1));
+            break;
+        case Op::NOT:
+            out.append(" ").append(regName(in.dst)).append(", ").append(regName(in.src1)).append(", 1");
+            break;
+        case Op::LW:
+            out.append(" ").append(regName(in.dst)).append(", ").append(std::to_string(in.imm)).append("(").append(regName(in.src1)).append(")");
+            break;
+        case Op::SW:
+            out.append(" ").append(regName(in.src1)).append(", ").append(std::to_string(in.imm)).append("(").append(regName(in.src2)).append(")");
+            break;
+        case Op::LWL:
+            out.append(" ").append(regName(in.dst)).append(", label").append(std::to_string(in.imm));
+            break;
+        case Op::SWL:
+            out.append(" ").append(regName(in.src1)).append(", label").append(std::to_string(in.imm));
+            break;
+        case Op::ADDI:
+        case Op::SUBI:
+        case Op::SLL:
+        case Op::SRL:
+        case Op::SRA:
+        case Op::ANDI:
+            out.append(" ").append(regName(in.dst)).append(", ").append(regName(in.src1)).append(", ").append(std::to_string(in.imm));
+            break;
+        case Op::BEQ:
+        case Op::BNE:
+        case Op::BLT:
+        case Op::BLE:
+        case Op::BGT:
+        case Op::BGE:
+            out.append(" ").append(regName(in.src1)).append(", ");
+            if (in.src2 == NO_REG) {
+                out.append(std::to_string(in.constant));
+            }
+            else {
+                out.append(regName(in.src2));
+            }
+            out.append(", label").append(std::to_string(in.imm));
+            break;
+        case Op::BLTZ:
+        case Op::BLEZ:
+        case Op::BGTZ:
+        case Op::BGEZ:
+            out.append(" ").append(regName(in.src1)).append(", label").append(std::to_string(in.imm));
+            break;
+        case Op::B:
+            out.append(" label").append(std::to_string(in.imm));
+            break;
+        case Op::J:
+            out.append(" end");
+            break;
+        case Op::JAL: {
+            StrRef name = interner.name(in.name);
+            out.append(" ").append(name.data, name.len);
+            break;
+        }
+        case Op::JR:
+            out.append(" ").append(regName(in.src1));
+            break;
+        case Op::MFHI:
+            out.append(" ").append(regName(in.dst));
+            break;
+        case Op::MULT:
+            out.append(" ").append(regName(in.src1)).append(", ").append(regName(in.src2));
+            break;
+        case Op::SYSCALL:
+            break;
+        default:
+            out.append(" ").append(regName(in.dst)).append(", ").append(regName(in.src1)).append(", ").append(regName(in.src2));
+            break;
+    }
+    out.append("\n");
+}
+
+#endif
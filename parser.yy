@@ -41,7 +41,8 @@
 
 /* Semantic type / YYSTYPE */
 %union{
-    std::string* strVal;
+    StrRef str;
+    Symbol sym;
     int ival;
     uint8_t enumVal;
     Prog *prog;
@@ -52,6 +53,7 @@
     Param *param;
     Block *block;
     Id *id;
+    std::vector<AST*> *nodes;
 };
 
 %token ADD "+"
@@ -85,8 +87,8 @@
 %token WHILE "while"
 %token BREAK "break"
 %token RETURN "return"
-%token <strVal> STRING "string"
-%token <strVal> ID "id"
+%token <str> STRING "string"
+%token <sym> ID "id"
 %token <ival> NUM "number"
 
 %type <ast> program
@@ -94,17 +96,17 @@
 %type <ast> mainfunctiondeclarator
 %type <ast> identifier
 %type <ast> globaldeclaration
-%type <ast> globaldeclarations
+%type <nodes> globaldeclarations
 %type <ast> variabledeclaration
 %type <ast> functiondeclarator
 %type <ast> functiondeclaration
 %type <ast> functionheader
 %type <enumVal> type
 %type <ast> formalparameter
-%type <ast> formalparameterlist
+%type <nodes> formalparameterlist
 %type <ast> block
 %type <ast> blockstatement
-%type <ast> blockstatements
+%type <nodes> blockstatements
 %type <ast> statement
 %type <ast> statementexpression
 %type <ast> expression
@@ -119,10 +121,13 @@
 %type <ast> unaryexpression
 %type <ast> conditionalandexpression
 %type <ast> conditionalorexpression
-%type <ast> argumentlist
+%type <nodes> argumentlist
 %type <ast> functioninvocation
 %type <ast> primary
 
+/* Lists are collected in source order and handed to their parent node in one go */
+%destructor { delete $$; } <nodes>
+
 /* Define the start symbol */
 %start start
 
@@ -139,19 +144,15 @@ Only one program node for the abstract syntax tree
 Each global declaration is a child of the program node
    */
 program         : globaldeclarations {$$ = new Prog(filename); 
-                                     $$->AddNode($1);
-                                     if ($1->hasNext()){
-                                            AST* tmp = $1;
-                                            while (tmp->hasNext()){
-                                                tmp = tmp->getNext();
-                                                $$->AddNode(tmp);
-                                            }
-                                        }}
+                                     for (AST* decl : *$1) {
+                                         $$->AddNode(decl);
+                                     }
+                                     delete $1;}
                 ;   
 
 
 literal         : NUM {$$ = new Num(@$.begin.line, $1);}
-                | STRING {$$ = new String(@$.begin.line, $1->c_str());}
+                | STRING {$$ = new String(@$.begin.line, $1);}
                 | TRUE {$$ = new Literal(@$.begin.line, Reserved::TRUE);}
                 | FALSE {$$ = new Literal(@$.begin.line, Reserved::FALSE);}
                 ;
@@ -160,8 +161,8 @@ type            : BOOL {$$ = Reserved::BOOL;}
                 | INT {$$ = Reserved::INT;}
                 ;
 
-globaldeclarations      : globaldeclaration 
-                        | globaldeclarations globaldeclaration  {$$ = $2; $$->setNext($1);}
+globaldeclarations      : globaldeclaration {$$ = new std::vector<AST*>{$1};}
+                        | globaldeclarations globaldeclaration  {$$ = $1; $$->push_back($2);}
                         ;
 
 globaldeclaration       : variabledeclaration   
@@ -169,10 +170,10 @@ globaldeclaration       : variabledeclaration
                         | mainfunctiondeclaration 
                         ;
 
-variabledeclaration     : type identifier SEMICOLON {$$ = new VarDecl(@$.begin.line, $1, $2->getName().c_str()); $$->AddNode($2);}
+variabledeclaration     : type identifier SEMICOLON {$$ = new VarDecl(@$.begin.line, $1, $2->getSymbol()); $$->AddNode($2);}
                         ;
 
-identifier              : ID {$$ = new Id(@$.begin.line, $1->c_str());}
+identifier              : ID {$$ = new Id(@$.begin.line, $1);}
                         ;
 
 functiondeclaration     : functionheader block {$$ = $1; $$->AddNode($2);}
@@ -182,47 +183,37 @@ functionheader          : type functiondeclarator {$$ = $2; $$->setType($1);}
                         | VOID functiondeclarator {$$ = $2; $$->setType(Reserved::VOID);}
                         ;
 
-functiondeclarator      : identifier OPENPAR formalparameterlist CLOSEPAR {$$ = new FuncDecl(@$.begin.line, $1->getName().c_str());
-                                                                            $$->AddNode($3);
-                                                                            $$->addParam();
-                                                                            if ($3->hasNext()){
-                                                                                AST* tmp = $3;
-                                                                                while (tmp->hasNext()){
-                                                                                    tmp = tmp->getNext();
-                                                                                    $$->AddNode(tmp);
-                                                                                    $$->addParam();
-                                                                                }
-                                                                            }}
-                        | identifier OPENPAR CLOSEPAR {$$ = new FuncDecl(@$.begin.line, $1->getName().c_str());} 
+functiondeclarator      : identifier OPENPAR formalparameterlist CLOSEPAR {$$ = new FuncDecl(@$.begin.line, $1->getSymbol());
+                                                                            for (AST* param : *$3) {
+                                                                                $$->AddNode(param);
+                                                                            }
+                                                                            delete $3;}
+                        | identifier OPENPAR CLOSEPAR {$$ = new FuncDecl(@$.begin.line, $1->getSymbol());} 
                         ;
 
-formalparameterlist     : formalparameter 
-                        | formalparameterlist COMMA formalparameter {$3->setNext($1); $$ = $3;}
+formalparameterlist     : formalparameter {$$ = new std::vector<AST*>{$1};}
+                        | formalparameterlist COMMA formalparameter {$$ = $1; $$->push_back($3);}
                         ;
 
-formalparameter         : type identifier {$$ = new Param(@$.begin.line, $1, $2->getName().c_str());}
+formalparameter         : type identifier {$$ = new Param(@$.begin.line, $1, $2->getSymbol());}
                         ;
 
 mainfunctiondeclaration : mainfunctiondeclarator block {$$ = $1; $$->AddNode($2);}
                         ;
 
-mainfunctiondeclarator  : identifier OPENPAR CLOSEPAR    {$$ = new MainDecl(@$.begin.line, $1->getName().c_str());}
+mainfunctiondeclarator  : identifier OPENPAR CLOSEPAR    {$$ = new MainDecl(@$.begin.line, $1->getSymbol());}
                         ;
 
 block                   : OPENBRACE blockstatements CLOSEBRACE {$$ = new Block(@$.begin.line);
-                                                                $$->AddNode($2);
-                                                                if ($2->hasNext()){
-                                                                    AST* tmp = $2;
-                                                                    while (tmp->hasNext()){
-                                                                        tmp = tmp->getNext();
-                                                                        $$->AddNode(tmp);
-                                                                    }
-                                                                } }
+                                                                for (AST* stmt : *$2) {
+                                                                    $$->AddNode(stmt);
+                                                                }
+                                                                delete $2;}
                         | OPENBRACE CLOSEBRACE                  {$$ = new Block(@$.begin.line);}
                         ;
 
-blockstatements         : blockstatement  
-                        | blockstatements blockstatement {$$ = $2; $$->setNext($1);}
+blockstatements         : blockstatement {$$ = new std::vector<AST*>{$1};}
+                        | blockstatements blockstatement {$$ = $1; $$->push_back($2);}
                         ;
 
 blockstatement          : variabledeclaration 
@@ -249,24 +240,20 @@ primary                 : literal
                         | functioninvocation
                         ;
 
-argumentlist            : expression
-                        | argumentlist COMMA expression {$3->setNext($1); $$ = $3;}
+argumentlist            : expression {$$ = new std::vector<AST*>{$1};}
+                        | argumentlist COMMA expression {$$ = $1; $$->push_back($3);}
                         ;
 
-functioninvocation      : identifier OPENPAR argumentlist CLOSEPAR {$$ = new FuncCall(@$.begin.line, $1->getName().c_str());
-                                                                    $$->AddNode($3);
-                                                                    if ($3->hasNext()){
-                                                                        AST* tmp = $3;
-                                                                        while (tmp->hasNext()){
-                                                                            tmp = tmp->getNext();
-                                                                            $$->AddNode(tmp);
-                                                                        }
-                                                                    }}
-                        | identifier OPENPAR CLOSEPAR   {$$ = new FuncCall(@$.begin.line, $1->getName().c_str());}
+functioninvocation      : identifier OPENPAR argumentlist CLOSEPAR {$$ = new FuncCall(@$.begin.line, $1->getSymbol());
+                                                                    for (AST* arg : *$3) {
+                                                                        $$->AddNode(arg);
+                                                                    }
+                                                                    delete $3;}
+                        | identifier OPENPAR CLOSEPAR   {$$ = new FuncCall(@$.begin.line, $1->getSymbol());}
                         ;
 
 postfixexpression       : primary 
-                        | identifier {$$ = new Id(@$.begin.line, $1->getName().c_str());}
+                        | identifier {$$ = new Id(@$.begin.line, $1->getSymbol());}
                         ;
 
 unaryexpression         : SUB unaryexpression {$$ = new Arithmetic(@$.begin.line, Oper::SUB); $$->AddNode($2);}
@@ -309,7 +296,7 @@ assignmentexpression    : conditionalorexpression
                         | assignment
                         ;
 
-assignment              : identifier ASSIGN assignmentexpression {$$ = new AssnStmt(@$.begin.line, $1->getName().c_str()); $$->AddNode($1); $$->AddNode($3);}
+assignment              : identifier ASSIGN assignmentexpression {$$ = new AssnStmt(@$.begin.line, $1->getSymbol()); $$->AddNode($1); $$->AddNode($3);}
                         ;
 
 expression              : assignmentexpression
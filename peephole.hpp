@@ -0,0 +1,295 @@
+#ifndef PEEPHOLE_HPP
+#define PEEPHOLE_HPP
+
+#include <vector>
+#include "mips.hpp"
+
+/*
+Peephole optimizer over the MIPS instructions of one function. The code is
+copied instruction by instruction, and after each one the rules are tried on the
+end of the copy until none applies, so a rewrite can enable another with the
+instructions before it. Each rule is a member function looking at the last
+instructions copied, listed with its name in the rule table. It counts how often
+each one applied, for --stats.
+
+It runs before register allocation, on virtual registers, and again after it
+for what allocation leaves, such as spill reloads. Whether a register is still
+needed is found by reading ahead in the block. Temporaries of the IR never
+outlive their block, so they are dead at the labels and branches the instruction
+selector marks as block edges, but not at those inside the code of a single IR
+instruction, such as printb. Other registers are assumed live into any block
+jumped to.
+*/
+class PeepholeOptimizer
+{
+    private:
+    struct Rule {
+        const char* name;
+        bool (PeepholeOptimizer::*apply)();
+    };
+
+    std::vector<Rule> rules;
+    const std::vector<Instr>* code = nullptr;
+    std::vector<Instr> out;
+    size_t next = 0;                            // Next instruction of code to copy
+    const std::vector<bool>* variables = nullptr;
+
+    static bool isCallerSaved(Reg reg) {
+        return (reg >= V0 && reg < S0) || reg == T8 || reg == T9 || reg == RA;
+    }
+
+    // Whether a virtual register holds an IR temporary, dead at the end of its block
+    bool isTemporary(Reg reg) const {
+        if (!isVirtual(reg)) {
+            return false;
+        }
+        size_t v = reg - FIRST_VIRTUAL;
+        return v >= variables->size() || !(*variables)[v];
+    }
+
+    static bool readsExplicitly(const Instr& in, Reg reg) {
+        return in.src1 == reg || in.src2 == reg;
+    }
+
+    static bool reads(const Instr& in, Reg reg) {
+        if (readsExplicitly(in, reg)) {
+            return true;
+        }
+        if (in.op == Op::JAL) {
+            return (reg >= A0 && reg < A0 + 4) || reg == SP;
+        }
+        return in.op == Op::SYSCALL && (reg == V0 || reg == A0);
+    }
+
+    // Whether the instruction sets reg, or makes its value useless, as a call
+    // does for the caller-saved registers
+    static bool writes(const Instr& in, Reg reg) {
+        return in.dst == reg || (in.op == Op::JAL && isCallerSaved(reg));
+    }
+
+    // Instructions whose only effect is setting dst
+    static bool isDefinition(Op op) {
+        return op == Op::LI || op == Op::LA || op == Op::MOVE || op == Op::LW || op == Op::LWL ||
+               (op >= Op::ADD && op <= Op::MFHI);
+    }
+
+    // Whether the value of reg is dead once control leaves the block at a branch
+    bool deadLeaving(const Instr& in, Reg reg) const {
+        switch (in.op) {
+            case Op::JR:
+                // A function returns $v0, and restores the registers it saved
+                return isVirtual(reg) || (reg != V0 && reg != SP && reg != RA && isCallerSaved(reg));
+            case Op::J:
+                return true;
+            default:
+                return in.blockEdge && isTemporary(reg);
+        }
+    }
+
+    // Whether the value of reg after the last instruction copied is never read
+    bool deadAfter(Reg reg) const {
+        static const size_t LOOKAHEAD = 64;
+        if (isBranch(out.back().op)) {
+            return deadLeaving(out.back(), reg);
+        }
+        for (size_t j = next; j < code->size() && j < next + LOOKAHEAD; j++) {
+            const Instr& in = (*code)[j];
+            if (reads(in, reg)) {
+                return false;
+            }
+            if (writes(in, reg)) {
+                return true;
+            }
+            if (isBranch(in.op)) {
+                return deadLeaving(in, reg);
+            }
+            if (in.op == Op::LABEL && in.blockEdge && isTemporary(reg)) {
+                return true;
+            }
+        }
+        // Falling off the end of main goes to the exit code
+        return next >= code->size();
+    }
+
+    Instr& last() {
+        return out.back();
+    }
+
+    Instr& previous() {
+        return out[out.size() - 2];
+    }
+
+    // sw r, x followed by lw d, x: the value is still in r
+    bool storeLoad() {
+        if (out.size() < 2) {
+            return false;
+        }
+        const Instr& store = previous();
+        Instr& load = last();
+        bool same = (store.op == Op::SW && load.op == Op::LW && store.src2 == load.src1 && store.imm == load.imm && load.dst != load.src1) ||
+                    (store.op == Op::SWL && load.op == Op::LWL && store.imm == load.imm);
+        if (!same) {
+            return false;
+        }
+        if (load.dst == store.src1) {
+            out.pop_back();
+        }
+        else {
+            load = {.op = Op::MOVE, .dst = load.dst, .src1 = store.src1};
+        }
+        return true;
+    }
+
+    // A value computed into a register only to be moved: compute it where it is moved to
+    bool copyIntoDefinition() {
+        if (out.size() < 2 || last().op != Op::MOVE) {
+            return false;
+        }
+        Instr& def = previous();
+        Reg from = last().src1;
+        if (!isDefinition(def.op) || def.dst != from || last().dst == from || !deadAfter(from)) {
+            return false;
+        }
+        def.dst = last().dst;
+        out.pop_back();
+        return true;
+    }
+
+    // move a, b followed by an instruction reading a, after which a is dead: read b there
+    bool copyForward() {
+        if (out.size() < 2 || previous().op != Op::MOVE) {
+            return false;
+        }
+        Reg to = previous().dst;
+        Reg from = previous().src1;
+        Instr& in = last();
+        if (to == from || !readsExplicitly(in, to) || in.op == Op::JAL || in.op == Op::SYSCALL) {
+            return false;
+        }
+        if (in.dst != to && !deadAfter(to)) {
+            return false;
+        }
+        if (in.src1 == to) {
+            in.src1 = from;
+        }
+        if (in.src2 == to) {
+            in.src2 = from;
+        }
+        out.erase(out.end() - 2);
+        return true;
+    }
+
+    // beq on a register just loaded with a constant, or on $0 twice, always or never branches
+    bool constantBranch() {
+        if (last().op != Op::BEQ) {
+            return false;
+        }
+        Instr& branch = last();
+        Reg tested = branch.src1 == ZERO ? branch.src2 : branch.src2 == ZERO ? branch.src1 : NO_REG;
+        int value;
+        bool loaded = false;
+        if (tested == ZERO) {
+            value = 0;
+        }
+        else if (tested != NO_REG && out.size() >= 2 && previous().op == Op::LI && previous().dst == tested) {
+            value = previous().imm;
+            loaded = true;
+        }
+        else {
+            return false;
+        }
+        bool edge = branch.blockEdge;
+        if (value == 0) {
+            branch = {.op = Op::B, .imm = branch.imm, .blockEdge = edge};
+        }
+        else {
+            out.pop_back();
+        }
+        // The constant was only there for the test
+        if (loaded && edge && isTemporary(tested)) {
+            out.erase(out.end() - (value == 0 ? 2 : 1));
+        }
+        return true;
+    }
+
+    // A branch to the label right after it. Only a few labels are looked back
+    // over, since nested loops can start with a long run of them.
+    bool branchToNext() {
+        static const size_t LOOKBEHIND = 8;
+        if (last().op != Op::LABEL) {
+            return false;
+        }
+        size_t i = out.size() - 1;
+        while (i > 0 && out[i].op == Op::LABEL && out.size() - i <= LOOKBEHIND) {
+            i--;
+        }
+        if ((out[i].op != Op::B && !isConditionalBranch(out[i].op)) || out[i].imm != last().imm) {
+            // Only the last label is checked, the ones before it were when they were copied
+            return false;
+        }
+        out.erase(out.begin() + i);
+        return true;
+    }
+
+    // Instructions after an unconditional jump, before any label
+    bool unreachable() {
+        if (out.size() < 2 || last().op == Op::LABEL) {
+            return false;
+        }
+        Op op = previous().op;
+        if (op != Op::B && op != Op::J && op != Op::JR) {
+            return false;
+        }
+        out.pop_back();
+        return true;
+    }
+
+    public:
+    std::vector<size_t> hits;   // Times each rule applied, over all functions
+
+    PeepholeOptimizer() {
+        rules = {
+            {"store-load", &PeepholeOptimizer::storeLoad},
+            {"copy-into-definition", &PeepholeOptimizer::copyIntoDefinition},
+            {"copy-forward", &PeepholeOptimizer::copyForward},
+            {"constant-branch", &PeepholeOptimizer::constantBranch},
+            {"branch-to-next", &PeepholeOptimizer::branchToNext},
+            {"unreachable", &PeepholeOptimizer::unreachable},
+        };
+        hits.assign(rules.size(), 0);
+    }
+
+    size_t numRules() const {
+        return rules.size();
+    }
+
+    const char* ruleName(size_t rule) const {
+        return rules[rule].name;
+    }
+
+    // Rewrites the code of a function. variables tells which virtual registers
+    // are the locals and parameters of the IR function, the others are temporaries.
+    void run(std::vector<Instr>& code, const std::vector<bool>& variables) {
+        this->code = &code;
+        this->variables = &variables;
+        out.clear();
+        out.reserve(code.size());
+        for (next = 0; next < code.size(); ) {
+            out.push_back(code[next++]);
+            bool applied = true;
+            while (applied && !out.empty()) {
+                applied = false;
+                for (size_t rule = 0; rule < rules.size(); rule++) {
+                    if ((this->*rules[rule].apply)()) {
+                        hits[rule]++;
+                        applied = true;
+                        break;
+                    }
+                }
+            }
+        }
+        code.swap(out);
+    }
+};
+
+#endif
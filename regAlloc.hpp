@@ -0,0 +1,491 @@
+#ifndef REG_ALLOC_HPP
+#define REG_ALLOC_HPP
+
+#include <algorithm>
+#include <climits>
+#include <vector>
+#include "mips.hpp"
+
+// Registers handed out by the allocator, $v1 and $t9 are left for spilled values
+const Reg CALLER_SAVED[] = {T0, T0+1, T0+2, T0+3, T0+4, T0+5, T0+6, T0+7, T8};
+const Reg CALLEE_SAVED[] = {S0, S0+1, S0+2, S0+3, S0+4, S0+5, S0+6, S0+7};
+
+/*
+Linear scan register allocator (Poletto and Sarkar) for the code of one function.
+
+Positions count two per instruction, the uses of an instruction come before its
+definition. The live interval of a virtual register runs from its first to its
+last position, stretched over the blocks it is live into or out of. Registers
+only used inside one block, like the temporaries of an expression, get their
+interval straight from their positions. The others are traced back from the
+blocks that use them through the predecessors, until the blocks that define
+them, so the cost follows the size of their live range and not of the function.
+
+The intervals are handed registers in order of their start. A value live across
+a call only gets a callee-saved register, others try the caller-saved ones first.
+When none is free, the interval that ends last is spilled to a stack slot in the
+frame. Every use of a spilled register loads it into $v1 or $t9 first, which are
+kept out of the allocation for that, and every definition stores it back.
+
+The variables of a function are virtual registers like any other value, so they
+stay in registers from one statement to the next and only the callee-saved
+registers the function ends up using are saved, once on entry.
+*/
+class RegisterAllocator
+{
+    private:
+    typedef std::pair<int, int> Ending;     // End of an interval and its register or slot
+
+    // Lists of numbers by key, added in any order and then grouped in one array
+    class Groups
+    {
+        private:
+        std::vector<std::pair<int, int>> added;
+        std::vector<int> first, items;
+
+        public:
+        void clear() {
+            added.clear();
+        }
+
+        void add(int key, int item) {
+            added.push_back({key, item});
+        }
+
+        void group(int numKeys) {
+            first.assign(numKeys + 1, 0);
+            for (const auto& pair : added) {
+                first[pair.first + 1]++;
+            }
+            for (int key = 0; key < numKeys; key++) {
+                first[key + 1] += first[key];
+            }
+            items.resize(added.size());
+            for (const auto& pair : added) {
+                items[first[pair.first]++] = pair.second;
+            }
+            // Each key's count was added to its start, so the starts are one key on
+            for (int key = numKeys; key > 0; key--) {
+                first[key] = first[key - 1];
+            }
+            first[0] = 0;
+        }
+
+        const int* begin(int key) const {
+            return items.data() + first[key];
+        }
+
+        const int* end(int key) const {
+            return items.data() + first[key + 1];
+        }
+    };
+
+    // Kept from one function to the next, so they only allocate for the largest
+    std::vector<int> start, end, firstBlock, global, globalIndex;
+    std::vector<Reg> assigned;
+    std::vector<int> slot;
+    std::vector<int> blockStart, calls, labelBlock;
+    Groups preds, defBlocks, useBlocks;
+    std::vector<int> definedIn, usedIn, defStamp, inStamp, outStamp, pending;
+    std::vector<int> liveAtEntry, order;
+    std::vector<Ending> active, freeSlots;
+    std::vector<Reg> saved;
+    std::vector<Instr> rewritten;
+
+    static int usePos(size_t i) {
+        return 2 * i;
+    }
+
+    static int defPos(size_t i) {
+        return 2 * i + 1;
+    }
+
+    void touch(Reg reg, size_t i, int block, bool def) {
+        int v = reg - FIRST_VIRTUAL;
+        int pos = def ? defPos(i) : usePos(i);
+        if (start[v] < 0) {
+            start[v] = pos;
+            firstBlock[v] = block;
+            // Read before anything set it: live into the function
+            global[v] = !def;
+        }
+        else if (firstBlock[v] != block) {
+            global[v] = true;
+        }
+        end[v] = std::max(end[v], pos);
+    }
+
+    // Splits code into basic blocks and finds the interval of every register
+    // used in a single block. Returns the number of blocks.
+    int scan(const std::vector<Instr>& code) {
+        blockStart.clear();
+        calls.clear();
+        int block = -1;
+        for (size_t i = 0; i < code.size(); i++) {
+            const Instr& in = code[i];
+            if (i == 0 || in.op == Op::LABEL || isBranch(code[i-1].op)) {
+                block++;
+                blockStart.push_back(i);
+            }
+            if (isVirtual(in.src1)) {
+                touch(in.src1, i, block, false);
+            }
+            if (isVirtual(in.src2)) {
+                touch(in.src2, i, block, false);
+            }
+            if (isVirtual(in.dst)) {
+                touch(in.dst, i, block, true);
+            }
+            if (in.op == Op::JAL) {
+                calls.push_back(defPos(i));
+            }
+        }
+        return block + 1;
+    }
+
+    // Stretches the intervals of the registers live across blocks
+    void traceGlobals(const std::vector<Instr>& code, int numBlocks) {
+        liveAtEntry.clear();
+        int numGlobals = 0;
+        for (size_t v = 0; v < start.size(); v++) {
+            globalIndex[v] = start[v] >= 0 && global[v] ? numGlobals++ : -1;
+        }
+        if (numGlobals == 0) {
+            return;
+        }
+
+        // Control flow between the blocks. The labels of a function are numbered
+        // in a run of their own, so they index labelBlock from the lowest one.
+        int firstLabel = INT_MAX, lastLabel = INT_MIN;
+        for (int b = 0; b < numBlocks; b++) {
+            const Instr& first = code[blockStart[b]];
+            if (first.op == Op::LABEL) {
+                firstLabel = std::min(firstLabel, first.imm);
+                lastLabel = std::max(lastLabel, first.imm);
+            }
+        }
+        if (firstLabel <= lastLabel) {
+            labelBlock.assign(lastLabel - firstLabel + 1, -1);
+        }
+        for (int b = 0; b < numBlocks; b++) {
+            const Instr& first = code[blockStart[b]];
+            if (first.op == Op::LABEL) {
+                labelBlock[first.imm - firstLabel] = b;
+            }
+        }
+        preds.clear();
+        for (int b = 0; b < numBlocks; b++) {
+            const Instr& last = code[blockEnd(b, code.size())];
+            if ((last.op == Op::B || isConditionalBranch(last.op)) && last.imm >= firstLabel && last.imm <= lastLabel) {
+                int target = labelBlock[last.imm - firstLabel];
+                if (target >= 0) {
+                    preds.add(target, b);
+                }
+            }
+            if (b + 1 < numBlocks && last.op != Op::B && last.op != Op::J && last.op != Op::JR) {
+                preds.add(b + 1, b);
+            }
+        }
+        preds.group(numBlocks);
+
+        // Blocks that define each register, and blocks that use it before defining it
+        defBlocks.clear();
+        useBlocks.clear();
+        definedIn.assign(numGlobals, -1);
+        usedIn.assign(numGlobals, -1);
+        int block = -1;
+        for (size_t i = 0; i < code.size(); i++) {
+            if (block + 1 < numBlocks && blockStart[block+1] == (int)i) {
+                block++;
+            }
+            const Instr& in = code[i];
+            for (Reg reg : {in.src1, in.src2}) {
+                int g = isVirtual(reg) ? globalIndex[reg - FIRST_VIRTUAL] : -1;
+                if (g >= 0 && definedIn[g] != block && usedIn[g] != block) {
+                    usedIn[g] = block;
+                    useBlocks.add(g, block);
+                }
+            }
+            int g = isVirtual(in.dst) ? globalIndex[in.dst - FIRST_VIRTUAL] : -1;
+            if (g >= 0 && definedIn[g] != block) {
+                definedIn[g] = block;
+                defBlocks.add(g, block);
+            }
+        }
+        defBlocks.group(numGlobals);
+        useBlocks.group(numGlobals);
+
+        defStamp.assign(numBlocks, -1);
+        inStamp.assign(numBlocks, -1);
+        outStamp.assign(numBlocks, -1);
+        for (size_t v = 0; v < start.size(); v++) {
+            int g = globalIndex[v];
+            if (g < 0) {
+                continue;
+            }
+            for (const int* b = defBlocks.begin(g); b != defBlocks.end(g); b++) {
+                defStamp[*b] = g;
+            }
+            for (const int* b = useBlocks.begin(g); b != useBlocks.end(g); b++) {
+                inStamp[*b] = g;
+                pending.push_back(*b);
+            }
+            while (!pending.empty()) {
+                int b = pending.back();
+                pending.pop_back();
+                // Live into b: from before its first instruction
+                start[v] = std::min(start[v], usePos(blockStart[b]) - 1);
+                for (const int* p = preds.begin(b); p != preds.end(b); p++) {
+                    if (outStamp[*p] != g) {
+                        outStamp[*p] = g;
+                        end[v] = std::max(end[v], defPos(blockEnd(*p, code.size())));
+                        if (defStamp[*p] != g && inStamp[*p] != g) {
+                            inStamp[*p] = g;
+                            pending.push_back(*p);
+                        }
+                    }
+                }
+            }
+            if (inStamp[0] == g) {
+                liveAtEntry.push_back(v);
+            }
+        }
+    }
+
+    void analyze(const std::vector<Instr>& code, size_t numRegs) {
+        start.assign(numRegs, -1);
+        end.assign(numRegs, -1);
+        firstBlock.assign(numRegs, -1);
+        global.assign(numRegs, 0);
+        globalIndex.resize(numRegs);
+        traceGlobals(code, scan(code));
+    }
+
+    int blockEnd(int b, size_t size) const {
+        return b + 1 < (int)blockStart.size() ? blockStart[b+1] - 1 : size - 1;
+    }
+
+    bool crossesCall(int from, int to) const {
+        auto call = std::upper_bound(calls.begin(), calls.end(), from);
+        return call != calls.end() && *call < to;
+    }
+
+    public:
+    // Counts over all functions, reported with --stats
+    size_t intervals = 0, spilled = 0, spillLoads = 0, spillStores = 0;
+
+    // Maps the virtual registers of code, numbered below lastReg, to machine
+    // registers and lays out the frame. The callee-saved registers it uses are
+    // saved unless saveRegisters is false, as for main, which never returns.
+    void allocate(std::vector<Instr>& code, Reg lastReg, bool saveRegisters) {
+        size_t numRegs = lastReg - FIRST_VIRTUAL;
+        analyze(code, numRegs);
+        // Variables read before anything is assigned to them on some path start
+        // out as 0, like the stack slots they used to live in
+        if (!liveAtEntry.empty()) {
+            size_t at = code[0].op == Op::ENTER ? 1 : 0;
+            code.insert(code.begin() + at, liveAtEntry.size(), Instr{Op::LI});
+            for (size_t i = 0; i < liveAtEntry.size(); i++) {
+                code[at + i].dst = FIRST_VIRTUAL + liveAtEntry[i];
+            }
+            analyze(code, numRegs);
+        }
+        assigned.assign(numRegs, NO_REG);
+        slot.assign(numRegs, -1);
+
+        order.clear();
+        for (size_t v = 0; v < numRegs; v++) {
+            if (start[v] >= 0) {
+                order.push_back(v);
+            }
+        }
+        std::sort(order.begin(), order.end(), [this](int a, int b) {
+            return start[a] < start[b] || (start[a] == start[b] && a < b);
+        });
+        intervals += order.size();
+
+        bool callee[FRAME] = {};
+        for (Reg reg : CALLEE_SAVED) {
+            callee[reg] = true;
+        }
+        bool free[FRAME] = {};
+        for (Reg reg : CALLER_SAVED) {
+            free[reg] = true;
+        }
+        for (Reg reg : CALLEE_SAVED) {
+            free[reg] = true;
+        }
+        bool used[FRAME] = {};
+        // Intervals holding a register by their end, and spill slots as a heap
+        // by the position they are free from, the earliest on top
+        active.clear();
+        freeSlots.clear();
+        int numSlots = 0;
+
+        auto activate = [this](int v) {
+            Ending ending = {end[v], v};
+            active.insert(std::upper_bound(active.begin(), active.end(), ending), ending);
+        };
+        auto spill = [this, &numSlots](int v) {
+            if (!freeSlots.empty() && freeSlots.front().first < start[v]) {
+                slot[v] = freeSlots.front().second;
+                std::pop_heap(freeSlots.begin(), freeSlots.end(), std::greater<Ending>());
+                freeSlots.pop_back();
+            }
+            else {
+                slot[v] = numSlots++;
+            }
+            freeSlots.push_back({end[v], slot[v]});
+            std::push_heap(freeSlots.begin(), freeSlots.end(), std::greater<Ending>());
+            spilled++;
+        };
+
+        for (int v : order) {
+            size_t expired = 0;
+            while (expired < active.size() && active[expired].first < start[v]) {
+                free[assigned[active[expired].second]] = true;
+                expired++;
+            }
+            active.erase(active.begin(), active.begin() + expired);
+            bool acrossCall = crossesCall(start[v], end[v]);
+            Reg chosen = NO_REG;
+            if (!acrossCall) {
+                for (Reg reg : CALLER_SAVED) {
+                    if (free[reg]) {
+                        chosen = reg;
+                        break;
+                    }
+                }
+            }
+            if (chosen == NO_REG) {
+                for (Reg reg : CALLEE_SAVED) {
+                    if (free[reg]) {
+                        chosen = reg;
+                        break;
+                    }
+                }
+            }
+            if (chosen != NO_REG) {
+                free[chosen] = false;
+                used[chosen] = true;
+                assigned[v] = chosen;
+                activate(v);
+                continue;
+            }
+            // Take the register of the interval that ends last, if it ends after this one
+            size_t victim = active.size();
+            for (size_t i = active.size(); i-- > 0 && active[i].first > end[v]; ) {
+                if (!acrossCall || callee[assigned[active[i].second]]) {
+                    victim = i;
+                    break;
+                }
+            }
+            if (victim == active.size()) {
+                spill(v);
+                continue;
+            }
+            int other = active[victim].second;
+            assigned[v] = assigned[other];
+            assigned[other] = NO_REG;
+            active.erase(active.begin() + victim);
+            activate(v);
+            spill(other);
+        }
+
+        saved.clear();
+        if (saveRegisters) {
+            for (Reg reg : CALLEE_SAVED) {
+                if (used[reg]) {
+                    saved.push_back(reg);
+                }
+            }
+            if (!calls.empty()) {
+                saved.push_back(RA);
+            }
+        }
+        rewrite(code, numSlots);
+    }
+
+    private:
+    // Frame from $sp up: the arguments of calls past the fourth, the spill slots
+    // and the saved registers
+    void rewrite(std::vector<Instr>& code, int numSlots) {
+        int outgoing = 0;
+        for (const Instr& in : code) {
+            if (in.op == Op::ENTER) {
+                outgoing = in.imm;
+                break;
+            }
+        }
+        int slots = outgoing;
+        int saves = slots + 4 * numSlots;
+        int frame = saves + 4 * saved.size();
+        rewritten.clear();
+        rewritten.reserve(code.size());
+        for (Instr in : code) {
+            if (in.op == Op::ENTER) {
+                if (frame > 0) {
+                    rewritten.push_back({.op = Op::SUBI, .dst = SP, .src1 = SP, .imm = frame});
+                }
+                for (size_t i = 0; i < saved.size(); i++) {
+                    rewritten.push_back({.op = Op::SW, .src1 = saved[i], .src2 = SP, .imm = saves + 4 * (int)i});
+                }
+                continue;
+            }
+            if (in.op == Op::LEAVE) {
+                for (size_t i = 0; i < saved.size(); i++) {
+                    rewritten.push_back({.op = Op::LW, .dst = saved[i], .src1 = SP, .imm = saves + 4 * (int)i});
+                }
+                if (frame > 0) {
+                    rewritten.push_back({.op = Op::ADDI, .dst = SP, .src1 = SP, .imm = frame});
+                }
+                continue;
+            }
+            Reg scratch = V1;
+            Reg loaded = NO_REG;
+            for (Reg* src : {&in.src1, &in.src2}) {
+                if (*src == FRAME) {
+                    *src = SP;
+                    in.imm += frame;
+                }
+                else if (isVirtual(*src)) {
+                    int v = *src - FIRST_VIRTUAL;
+                    if (assigned[v] != NO_REG) {
+                        *src = assigned[v];
+                    }
+                    else if (*src == loaded) {
+                        *src = V1;
+                    }
+                    else {
+                        loaded = *src;
+                        rewritten.push_back({.op = Op::LW, .dst = scratch, .src1 = SP, .imm = slots + 4 * slot[v]});
+                        spillLoads++;
+                        *src = scratch;
+                        scratch = T9;
+                    }
+                }
+            }
+            int store = -1;
+            if (isVirtual(in.dst)) {
+                int v = in.dst - FIRST_VIRTUAL;
+                if (assigned[v] != NO_REG) {
+                    in.dst = assigned[v];
+                }
+                else {
+                    in.dst = V1;
+                    store = slot[v];
+                }
+            }
+            if (in.op != Op::MOVE || in.dst != in.src1) {
+                rewritten.push_back(in);
+            }
+            if (store >= 0) {
+                rewritten.push_back({.op = Op::SW, .src1 = V1, .src2 = SP, .imm = slots + 4 * store});
+                spillStores++;
+            }
+        }
+        code.swap(rewritten);
+    }
+};
+
+#endif
@@ -15,21 +15,44 @@
 
 #include "parser.hh"
 #include "location.hh"
+#include "source.hpp"
 
 namespace JCC{
     class Lexer : public yyFlexLexer {
         public:
 
         Lexer(std::istream *in) : yyFlexLexer(in) {};
+
+        // Reads from a memory mapped source file, token values become views into the mapping
+        Lexer(const SourceFile *src) : yyFlexLexer(), source(src) {};
         
         virtual ~Lexer() = default;
 
         // Redefining yylex. Flex will generate this for us. Just create the prototype.
         virtual int yylex(JCC::Parser::semantic_type *yylval, JCC::Parser::location_type *location);
+
+        protected:
+        int LexerInput(char *buf, int max_size) override;
+
+        private:
+        const SourceFile *source = nullptr;
+        size_t inputPos = 0;    // Bytes of the source handed to flex so far
+        size_t tokenStart = 0;  // Source offset of yytext
+        size_t matchEnd = 0;    // Source offset just past the last match
+        int moreLength = 0;     // Length of yytext already matched before a yymore()
+
+        StrRef tokenText();
+        Symbol tokenSymbol();
     };
 }
 
 std::unique_ptr<JCC::Lexer> createLexer(std::istream* input);
+std::unique_ptr<JCC::Lexer> createLexer(const SourceFile& source);
+
+// Scanner warnings, shared by the flex scanner and the hand-written one in simdLexer.cpp
+extern int warnings;
+extern int linewarnings;
+void badCharacter(int line);
 
 
 #endif
\ No newline at end of file
@@ -29,216 +29,465 @@ messages as they occur. Checks for errors based on the following semantic inform
 #include <unordered_map>
 #include <stack> 
 #include <memory>
+#include <chrono>
+#include <sstream>
+#include <atomic>
 using namespace std;
 #include "ast.hpp"
+#include "visitor.hpp"
+#include "symbolTable.hpp"
+#include "threadPool.hpp"
+
+// How the passes after the global declarations are run, set by --sema
+enum class SemaMode {
+    PASSES,     // One walk per pass
+    FUSED,      // All passes in one walk
+    PARALLEL    // All passes in one walk per top-level declaration, on a thread pool
+};
 
 //Data structures
-struct entry {
-    int scope;
-    int paramNum;
-    string type;
-    unordered_map<string,entry>* symTable;
-    string nodeType;
-    string attr;
+static SymbolTable symbols;
+// Table the current thread declares parameters and locals in. With --sema=parallel
+// every thread has one of its own, the shared table only holds the library
+// functions and the globals then and is only read while the functions are checked.
+static thread_local SymbolTable* localSymbols = &symbols;
+static vector<unique_ptr<SymbolTable>> threadSymbols;
+// Scopes a name is looked up in, innermost last: the library, the globals and the current function
+static thread_local vector<ScopeId> scopeStack;
+static thread_local int whileLoops = 0, numOfBlocks = 0, scope = 0;
+static int mainDecls = 0;
+static atomic<int> errors(0);
+static SemaMode semaMode = SemaMode::PASSES;
+// Threads used by --sema=parallel, set by --threads. 0 is one per core.
+static unsigned semaThreads = 0;
+static const unsigned MAX_SEMA_THREADS = 1024;
+// Wall-clock time of each semantic pass in milliseconds, reported with --stats
+static vector<pair<string, double>> passTimes;
+
+
+// Semantic checks 1, 2 and 13 for the global scope. Also sets up symbol tables
+// for function declarations and global variables. Declarations are handled on
+// the way out of the node, as the original post-order traversal did.
+class GlobalPass : public Visitor<GlobalPass> {
+    public:
+    void enter(AST* node);
+    void leave(AST* node);
+};
+
+// Pushes the symbol table of each function on the scope stack while the
+// function is walked. Walked together with the passes that look names up.
+class FunctionScopes : public Visitor<FunctionScopes> {
+    public:
+    void enter(AST* node);
+    void leave(AST* node);
+};
+
+// Base of the passes below. Error messages go to out, which is cerr unless the
+// passes share a walk and their messages are held back to keep the pass order.
+template <typename Derived>
+class SemanticPass : public Visitor<Derived> {
+    public:
+    SemanticPass(ostream& out) : out(out) {}
+
+    protected:
+    ostream& out;
+};
+
+/*
+Semantic checks 3, 13 and 14: declarations must be in the outermost block of a
+function and unique in their scope, identifiers must be declared.
+
+Also resolves each identifier, assignment and call to the entry of the declaration
+in scope where it is used, so that no later pass looks a name up again. The names
+in the expressions of a statement are all resolved when the statement is entered,
+since TypePass checks the statement as soon as it enters it too. Expressions don't
+declare anything, so they resolve the same as they would one node at a time.
+*/
+class ScopePass : public SemanticPass<ScopePass> {
+    public:
+    using SemanticPass::SemanticPass;
+    void enter(AST* node);
+    void leave(AST* node);
+
+    private:
+    AST* expression = nullptr;  // Expression being walked whose names are resolved
+
+    void resolveNames(AST* root);
 };
-static unordered_map<string, entry> symTables[30];
-static vector<unordered_map<string,entry>*> scopeStack;
-static int whileLoops = 0, numOfBlocks = 0, scope = 0, errors = 0, symIt = 0;
-static bool before = true;
 
+/*
+Semantic checks 4, 5 and 7 to 12: calls, operator and condition types and returns.
+
+Uses the declarations ScopePass bound the names to, so in a fused walk it must
+come after ScopePass. There the return statements of a function are only bound
+once the function has been walked, so they are checked when it is left and their
+messages put back where the separate pass would have printed them.
+*/
+class TypePass : public SemanticPass<TypePass> {
+    public:
+    // Runs on its own and writes its messages to out
+    TypePass(ostream& out) : SemanticPass(out) {}
+    // Runs in a fused walk and writes its messages to buffer
+    TypePass(ostringstream& buffer) : SemanticPass(buffer), buffer(&buffer) {}
+    void enter(AST* node);
+    void leave(AST* node);
+
+    private:
+    ostringstream* buffer = nullptr;
+    size_t funcStart = 0;       // Where the messages of the current function begin in buffer
+
+    void check(AST* node);
+    void checkReturns(AST* func, ostream& out);
+};
+
+// Semantic check 6: break statements must be inside a while statement
+class BreakPass : public SemanticPass<BreakPass> {
+    public:
+    using SemanticPass::SemanticPass;
+    void enter(AST* node);
+    void leave(AST* node);
+};
 
 //Functions
 inline AST* semanticAnalyzer(AST* root);
-inline AST* postOrderTrav(AST* root, AST* (*func)(AST *));
-inline AST* preOrderTrav(AST* root, AST* (*func)(AST *));
-inline AST* prePostTrav(AST* root, AST* (*func)(AST *));
-inline AST* firstPass(AST* node); 
-inline AST* secondPass(AST* node); 
-inline AST* thirdPass(AST* node); 
-inline AST* fourthPass(AST* node); 
+inline bool isFuncDecl(AST* node);
+inline bool declareGlobal(AST* node);
+inline void checkInParallel(AST* root);
 inline void addPreDefined();
-inline void checkForMain(unordered_map<string, entry> global);
-inline string getIdType(string name);
-inline string typeCheck(AST* node);
-inline bool checkForReturn(AST* node, string returnType);
+inline void checkForMain(int mains);
+inline SymbolTable& tableOf(ScopeId scope);
+inline entry* resolve(Symbol name);
+inline Type declType(AST* node);
+inline Type typeCheck(AST* node, ostream& out);
+inline bool checkForReturn(AST* node, Type returnType, bool matchType, ostream& out);
+inline double elapsedMillis(chrono::steady_clock::time_point& start);
 
 inline AST* semanticAnalyzer(AST* root) {
-    unordered_map<string, entry> preDefined;
-    symTables[symIt] = preDefined;
-    unordered_map<string, entry>* prePtr = &symTables[symIt];
-    symIt++;
-    scopeStack.push_back(prePtr);
+    scopeStack.push_back(LIBRARY_SCOPE);
     addPreDefined();
-    unordered_map<string, entry> globalStack;
-    symTables[symIt] = globalStack;
-    unordered_map<string, entry>* globalPtr = &symTables[symIt];
-    symIt++;
-    scopeStack.push_back(globalPtr);
+    scopeStack.push_back(GLOBAL_SCOPE);
 
-    //First pass, checks for semantic checks 1 and 2
+    auto start = chrono::steady_clock::now();
+    FunctionScopes scopes;
     scope = 1;
-    postOrderTrav(root, &firstPass);
-    checkForMain(*scopeStack.at(1));
+    bool fused = false;
+    if (semaMode != SemaMode::PASSES) {
+        // Global declarations are all direct children of the program node
+        fused = true;
+        for (AST* decl : root->getChildren()) {
+            fused = declareGlobal(decl) && fused;
+        }
+        checkForMain(mainDecls);
+        passTimes.push_back({"Global declarations", elapsedMillis(start)});
+    }
+    else {
+        //First pass, checks for semantic checks 1 and 2
+        GlobalPass().walk(root);
+        checkForMain(mainDecls);
+        passTimes.push_back({"Semantic pass 1", elapsedMillis(start)});
+    }
     scope = 1;
-    //Second pass, checks for semantic checks 3,13,14
-    prePostTrav(root, &secondPass);
-    prePostTrav(root, &thirdPass);
-    prePostTrav(root, &fourthPass);
-    return root;
-}
 
-// Calls the given function only after calling it on all of the nodes children
-inline AST* postOrderTrav(AST* root, AST* (*func)(AST *)) {
-    bool scopeChange = false;
-    if ((root->getNodeType() == "maindecl") || (root->getNodeType() == "funcDecl")) {
-        scope++;
-        scopeChange = true;
-        }
-    for (AST* node : root->getChildren()) {
-        postOrderTrav(node, func);
+    // A function declared twice shares the symbol table of the first one,
+    // which only the separate passes below check in the expected order
+    if (fused && semaMode == SemaMode::PARALLEL) {
+        checkInParallel(root);
+        passTimes.push_back({"Parallel semantic walk", elapsedMillis(start)});
+        return root;
     }
-    if (scopeChange) {
-        scope--;
+    if (fused) {
+        // Every other check in one walk. The messages of each pass are printed
+        // after the walk, in the order the separate passes would print them.
+        ostringstream scopeOut, typeOut, breakOut;
+        ScopePass scopePass(scopeOut);
+        TypePass typePass(typeOut);
+        BreakPass breakPass(breakOut);
+        walkFused(root, scopes, scopePass, typePass, breakPass);
+        cerr << scopeOut.str() << typeOut.str() << breakOut.str();
+        passTimes.push_back({"Fused semantic walk", elapsedMillis(start)});
+        return root;
     }
-    func(root);
+
+    //Second pass, checks for semantic checks 3,13,14 and binds the names to their declarations
+    ScopePass scopePass(cerr);
+    walkFused(root, scopes, scopePass);
+    passTimes.push_back({"Semantic pass 2", elapsedMillis(start)});
+    TypePass(cerr).walk(root);
+    passTimes.push_back({"Semantic pass 3", elapsedMillis(start)});
+    BreakPass(cerr).walk(root);
+    passTimes.push_back({"Semantic pass 4", elapsedMillis(start)});
     return root;
+}
+
+// Error messages of a top-level declaration, by the pass that found them
+struct DeclMessages {
+    string scope, type, breaks;
 };
 
-// Calls the given function only before calling it on all of the nodes children
-inline AST* preOrderTrav(AST* root, AST* (*func)(AST *)) {
-    func(root);
-    bool scopeChange = false;
-    if ((root->getNodeType() == "maindecl") || (root->getNodeType() == "funcDecl")) {
-        scope++;
-        scopeChange = true;
-        }
-    for (AST* node : root->getChildren()) {
-        preOrderTrav(node, func);
+// Runs the fused walk on each top-level declaration as a job of its own. The
+// globals are all declared by now and calls are checked against signatures, so
+// no function looks into the scope of another. Each thread has its own scope
+// stack and declares the parameters and locals of its functions in its own
+// table. The messages are kept per declaration and printed once all are done,
+// in the order the separate passes would print them.
+inline void checkInParallel(AST* root) {
+    const ChildList& decls = root->getChildren();
+    vector<DeclMessages> messages(decls.size());
+    WorkStealingPool pool(semaThreads);
+    for (unsigned i = 0; i < pool.numThreads(); i++) {
+        threadSymbols.push_back(make_unique<SymbolTable>());
     }
-    if (scopeChange) {
-        scope--;
+    pool.run(decls.size(), [&](size_t job, unsigned worker) {
+        // Reused by the jobs of a thread
+        thread_local ostringstream scopeOut, typeOut, breakOut;
+        localSymbols = threadSymbols[worker].get();
+        scopeStack.assign({LIBRARY_SCOPE, GLOBAL_SCOPE});
+        scope = 1;
+        FunctionScopes scopes;
+        ScopePass scopePass(scopeOut);
+        TypePass typePass(typeOut);
+        BreakPass breakPass(breakOut);
+        walkFused(decls[job], scopes, scopePass, typePass, breakPass);
+        auto take = [](ostringstream& out) {
+            string taken = out.str();
+            out.str("");
+            return taken;
+        };
+        messages[job] = {take(scopeOut), take(typeOut), take(breakOut)};
+    });
+    localSymbols = &symbols;
+    for (DeclMessages& decl : messages) {
+        cerr << decl.scope;
     }
-    return root;
-};
+    for (DeclMessages& decl : messages) {
+        cerr << decl.type;
+    }
+    for (DeclMessages& decl : messages) {
+        cerr << decl.breaks;
+    }
+}
+
+// Returns the milliseconds since start and restarts the clock
+inline double elapsedMillis(chrono::steady_clock::time_point& start) {
+    auto now = chrono::steady_clock::now();
+    double millis = chrono::duration<double, milli>(now - start).count();
+    start = now;
+    return millis;
+}
+
+inline bool isFuncDecl(AST* node) {
+    return (node->getKind() == NodeKind::MAIN_DECL) || (node->getKind() == NodeKind::FUNC_DECL);
+}
 
-// Calls the given function before and after calling it on all of the nodes children
-inline AST* prePostTrav(AST* root, AST* (*func)(AST *)) {
-    before = true;
-    func(root);
-    bool scopeChange = false;
-    for (AST* node : root->getChildren()) {
-        prePostTrav(node, func);
+inline void GlobalPass::enter(AST* node) {
+    if (isFuncDecl(node)) {
+        scope++;
     }
-    before = false;
-    func(root);
-    return root;
-};
+}
 
-inline AST* firstPass(AST* node) {
-    // Semantic check 13 for global scope. Also sets up symbol tables for function declarations and global variables
+inline void GlobalPass::leave(AST* node) {
+    if (isFuncDecl(node)) {
+        scope--;
+    }
     if (scope == 1) {
-        if (node->getNodeType() == "vardecl") {
-            entry newEntry = {.scope = 1, .type = node->getType(), .nodeType = node->getNodeType()};
-            if (!scopeStack.at(1)->insert({node->getName(), newEntry}).second) {
+        declareGlobal(node);
+    }
+}
+
+// Semantic check 13 for global scope. Also sets up symbol tables for function
+// declarations and global variables. Returns false if the name was already declared.
+inline bool declareGlobal(AST* node) {
+    bool declared = true;
+    switch (node->getKind()) {
+        case NodeKind::VAR_DECL: {
+            entry newEntry = {.scope = 1, .type = typeOf(node->getType()), .nodeType = node->getKind()};
+            if (!symbols.insert(GLOBAL_SCOPE, node->getSymbol(), newEntry)) {
                 cerr << "Error: A global variable was re-declared near line: " << node->getLineNo() << "." << endl;
                 errors++;
+                declared = false;
             };
-            auto loc = scopeStack.at(1)->at(node->getName());
-            node->setLoc(&loc);
-        }
-        else if (node->getNodeType() == "maindecl" || node->getNodeType() == "funcdecl") {
-            unordered_map<string, entry> funcTable;
-            symTables[symIt] = funcTable;
-            entry newEntry = {.scope = 1, .type = node->getType(), .symTable = &symTables[symIt], .nodeType = node->getNodeType()};
-            if (!scopeStack.at(1)->insert({node->getName(), newEntry}).second) {
+            node->setDecl(symbols.find(GLOBAL_SCOPE, node->getSymbol()));
+            break;
+        }
+        case NodeKind::MAIN_DECL:
+        case NodeKind::FUNC_DECL: {
+            // The parameters come first among the children of a function
+            Signature signature = {typeOf(node->getType()), {}};
+            for (AST* child : node->getChildren()) {
+                if (child->getKind() == NodeKind::PARAM) {
+                    signature.params.push_back(typeOf(child->getType()));
+                }
+            }
+            entry newEntry = {.scope = 1, .type = signature.returnType, .nodeType = node->getKind(), .symTable = symbols.newScope(),
+                              .signature = symbols.addSignature(signature)};
+            if (!symbols.insert(GLOBAL_SCOPE, node->getSymbol(), newEntry)) {
                 cerr << "Error: A function was re-declared near line: " << node->getLineNo() << "." << endl;
                 errors++;
+                declared = false;
+            }
+            else if (node->getKind() == NodeKind::MAIN_DECL) {
+                mainDecls++;
             };
-            auto loc = scopeStack.at(1)->at(node->getName());
-            node->setLoc(&loc);
-            symIt++;
+            node->setDecl(symbols.find(GLOBAL_SCOPE, node->getSymbol()));
+            break;
         }
+        default:
+            break;
     }
-        return node;
-};
+    return declared;
+}
 
-inline AST* secondPass(AST* node) {
-    // Semantic checks 3, 13, 14: check if node has already been identified in the same scope
-    if (node->getNodeType() == "block") {
-        if (before) {
-            numOfBlocks++;
-        }
-        else {
-            numOfBlocks--;
+inline void FunctionScopes::enter(AST* node) {
+    if (isFuncDecl(node)) {
+        scopeStack.push_back(symbols.find(GLOBAL_SCOPE, node->getSymbol())->symTable);
+        scope++;
+    }
+}
+
+inline void FunctionScopes::leave(AST* node) {
+    if (isFuncDecl(node)) {
+        scope--;
+        scopeStack.pop_back();
+    }
+}
+
+inline void ScopePass::enter(AST* node) {
+    if (expression == nullptr) {
+        switch (node->getKind()) {
+            case NodeKind::IF_STMT:
+            case NodeKind::WHILE_STMT:
+                expression = node->getChild(0);
+                resolveNames(expression);
+                break;
+            case NodeKind::ASSN_STMT:
+            case NodeKind::FUNC_CALL:
+            case NodeKind::RET_STMT:
+                expression = node;
+                resolveNames(expression);
+                break;
+            default:
+                break;
         }
     }
+    switch (node->getKind()) {
+        case NodeKind::BLOCK:
+            numOfBlocks++;
+            break;
 
-    else if (before && (node->getNodeType() == "vardecl")) {
-        if (scope > 1) {
-            // Semantic check 3: A local declaration was not in an outermost block.
-            if (numOfBlocks > 1) {
-                cerr << "Error: A local declaration was not in an outermost block near line: " << node->getLineNo() << "." << endl;
-                errors++;
-            }
-            // Semantic check 13: identifier is redefined within the same scope.
-            entry newEntry = {.scope = scope, .type = node->getType(), .nodeType = node->getNodeType()};
-            if (!scopeStack.back()->insert({node->getName(), newEntry}).second) {
-                    cerr << "Error: Variable redeclaration in same scope around line: " << node->getLineNo() << "." << endl;
+        case NodeKind::VAR_DECL:
+            if (scope > 1) {
+                // Semantic check 3: A local declaration was not in an outermost block.
+                if (numOfBlocks > 1) {
+                    out << "Error: A local declaration was not in an outermost block near line: " << node->getLineNo() << "." << endl;
                     errors++;
+                }
+                // Semantic check 13: identifier is redefined within the same scope.
+                entry newEntry = {.scope = scope, .type = typeOf(node->getType()), .nodeType = node->getKind()};
+                if (!localSymbols->insert(scopeStack.back(), node->getSymbol(), newEntry)) {
+                        out << "Error: Variable redeclaration in same scope around line: " << node->getLineNo() << "." << endl;
+                        errors++;
+                }
+                node->setDecl(localSymbols->find(scopeStack.back(), node->getSymbol()));
             }
-            auto loc = scopeStack.at(scope)->at(node->getName());
-            node->setLoc(&loc);
+            // The identifier being declared
+            node->getChild(0)->setDecl(node->getDecl());
+            break;
+
+        // Add Params to local function symbol table if inside function
+        case NodeKind::PARAM: {
+            entry newEntry = {.scope = scope, .paramNum = node->getParamNum(), .type = typeOf(node->getType()), .nodeType = node->getKind()};
+            if (!localSymbols->insert(scopeStack.at(scope), node->getSymbol(), newEntry)) {
+                out << "Error: Param reused in same function near line: " << node->getLineNo() << "." << endl;
+                errors++;
+            }
+            node->setDecl(localSymbols->find(scopeStack.at(scope), node->getSymbol()));
+            break;
         }
+
+        default:
+            break;
     }
-    // Update scope stack for the current function declaration
-    else if (node->getNodeType() == "maindecl" || node->getNodeType() == "funcdecl") {
-        if (before) {
-            unordered_map<string, entry>* ptr = scopeStack.at(1)->at(node->getName()).symTable;
-            scopeStack.push_back(ptr);
-            scope++;
-        }
-        else {
-            scope--;
-            scopeStack.pop_back();
-        }
+}
+
+inline void ScopePass::leave(AST* node) {
+    if (node->getKind() == NodeKind::BLOCK) {
+        numOfBlocks--;
     }
-    // Sematic check 14: An undeclared identifier is used.
-    else if (before && ((node->getNodeType() == "funccall") || (node->getNodeType() == "id"))) { 
-        int size = scopeStack.size() - 1;
-        bool exists = false;
-        for (int i = size; i >= 0; i--) {
-            if (scopeStack.at(i)->find(node->getName()) != scopeStack.at(i)->end()) {
-                i = -1;
-                exists = true;
-            }    
-        }
-        if (!exists) {
-            if (node->getNodeType() == "funccall") {
-                cerr << "Error: Function called that was never declared around line: " << node->getLineNo() << "." << endl;
-                errors++;
-            }
-            else if (node->getNodeType() == "id") {
-                cerr << "Error: Identifier used that was never declared around line: " << node->getLineNo() << "." << endl;
-                errors++;
+    if (node == expression) {
+        expression = nullptr;
+    }
+}
+
+// Sematic check 14: An undeclared identifier is used. Binds the identifiers,
+// assignments and calls under root, visited in preorder from an explicit stack.
+inline void ScopePass::resolveNames(AST* root) {
+    vector<AST*> pending = {root};
+    while (!pending.empty()) {
+        AST* node = pending.back();
+        pending.pop_back();
+        int first = 0;
+        switch (node->getKind()) {
+            // The variable assigned to is the identifier on the left
+            case NodeKind::ASSN_STMT: {
+                AST* id = node->getChild(0);
+                id->setDecl(resolve(id->getSymbol()));
+                node->setDecl(id->getDecl());
+                if (id->getDecl() == nullptr) {
+                    out << "Error: Identifier used that was never declared around line: " << id->getLineNo() << "." << endl;
+                    errors++;
+                }
+                first = 1;
+                break;
             }
+            case NodeKind::ID:
+            case NodeKind::FUNC_CALL:
+                node->setDecl(resolve(node->getSymbol()));
+                if (node->getDecl() == nullptr) {
+                    if (node->getKind() == NodeKind::FUNC_CALL) {
+                        out << "Error: Function called that was never declared around line: " << node->getLineNo() << "." << endl;
+                        errors++;
+                    }
+                    else {
+                        out << "Error: Identifier used that was never declared around line: " << node->getLineNo() << "." << endl;
+                        errors++;
+                    }
+                }
+                break;
+            default:
+                break;
         }
-        
-    }
-    // Add Params to local function symbol table if inside function
-    else if (before && (node->getNodeType() == "param")) {
-        entry newEntry = {.scope = scope, .paramNum = node->getParamNum(), .type = node->getType(), .nodeType = node->getNodeType()};
-        if (!scopeStack.at(scope)->insert({node->getName(), newEntry}).second) {
-            cerr << "Error: Param reused in same function near line: " << node->getLineNo() << "." << endl;
-            errors++;
+        for (int i = node->numChildren(); i --> first;) {
+            pending.push_back(node->getChild(i));
         }
-        auto loc = scopeStack.at(scope)->at(node->getName());
-        node->setLoc(&loc);
     }
+}
 
-    return node;
-};
+inline void TypePass::enter(AST* node) {
+    if (buffer != nullptr && isFuncDecl(node)) {
+        funcStart = buffer->tellp();
+    }
+    else {
+        check(node);
+    }
+}
+
+inline void TypePass::leave(AST* node) {
+    if (buffer == nullptr || !isFuncDecl(node)) {
+        return;
+    }
+    // The separate pass checks the returns when it enters the function, so
+    // their messages go before the ones found in the function body
+    ostringstream returns;
+    checkReturns(node, returns);
+    if (returns.tellp() > 0) {
+        string messages = buffer->str();
+        messages.insert(funcStart, returns.str());
+        buffer->str(messages);
+        buffer->seekp(0, ios::end);
+    }
+}
 
-inline AST* thirdPass(AST* node) {
+inline void TypePass::check(AST* node) {
     /*
     Semantic checks:
     4. The number/type of arguments in a function call doesn't match the function's declaration.
@@ -250,209 +499,163 @@ inline AST* thirdPass(AST* node) {
     11. A value returned from a function has the wrong type.
     12. An if- or while-condition must be of Boolean type.
     */
+    switch (node->getKind()) {
+        // Semantic checks 4 and 5
+        case NodeKind::FUNC_CALL: {
+            entry* funcDecl = node->getDecl();
+            node->setExprType(declType(node));
+            if (funcDecl == nullptr) {
 
-    // Semantic checks 4 and 5
-    if (before && (node->getNodeType() == "funccall")) {
-        entry funcDecl;
-        int size = scopeStack.size();
-        bool exists = false;
-        for (int i = 0; i < size; i++) {
-            auto it = scopeStack.at(i)->find(node->getName());
-            if (it != scopeStack.at(i)->end()) {
-                funcDecl = scopeStack.at(i)->at(node->getName());
-                exists = true;
-            }
-        }
-        if (!exists) {
-
-        }
-        //Semantic check 5
-        else if (funcDecl.nodeType == "maindecl") {
-            cerr << "Error: Main function called near line: " << node->getLineNo() << "." << endl;
-            errors++;
-        }
-        //Semantic check 4
-        else {
-            int funcCallParams = node->getChildren().size();
-            int funcDeclParams = 0;
-            unordered_map<string, entry> * funcTable = funcDecl.symTable;
-            for (auto& it : *funcTable) {
-                if (it.second.paramNum != 0) {
-                    funcDeclParams++;
-                }
             }
-            if (funcCallParams != funcDeclParams) {
-                cerr << "Error: Function invocation near line " << node->getLineNo() << " uses " << funcCallParams << " argument(s) when it should use " << funcDeclParams << " argument(s)." << endl;
+            //Semantic check 5
+            else if (funcDecl->nodeType == NodeKind::MAIN_DECL) {
+                out << "Error: Main function called near line: " << node->getLineNo() << "." << endl;
                 errors++;
             }
-            for (int parNum = 1; parNum <= funcCallParams; parNum++) {
-                string nodeType = node->getChildren().at(parNum-1)->getNodeType();
-                string type;
-                if (nodeType == "string") {
-                    type = "string";
-                }
-                else {
-                    type = getIdType(node->getChildren().at(parNum-1)->getName());
+            //Semantic check 4
+            else {
+                // A variable called like a function takes no arguments
+                static const vector<Type> noParams;
+                const vector<Type>& params = funcDecl->signature != nullptr ? funcDecl->signature->params : noParams;
+                int funcCallParams = node->numChildren();
+                int funcDeclParams = params.size();
+                if (funcCallParams != funcDeclParams) {
+                    out << "Error: Function invocation near line " << node->getLineNo() << " uses " << funcCallParams << " argument(s) when it should use " << funcDeclParams << " argument(s)." << endl;
+                    errors++;
                 }
-                if (type != "") {
-                    for (auto& it : *funcTable) {
-                        if (it.second.paramNum == parNum) {
-                            if (!(type == it.second.type)) {
-                                cerr << "Error: Wrong type used in function call near line: " << node->getLineNo() << ". ";
-                                cerr << type << " used instead of " << it.second.type << "." << endl;
-                                errors++;
-                            }
-                        }
+                for (int parNum = 1; parNum <= funcCallParams; parNum++) {
+                    Type type = typeCheck(node->getChild(parNum-1), out);
+                    if (type != Type::NONE && parNum <= funcDeclParams && type != params[parNum-1]) {
+                        out << "Error: Wrong type used in function call near line: " << node->getLineNo() << ". ";
+                        out << typeName(type) << " used instead of " << typeName(params[parNum-1]) << "." << endl;
+                        errors++;
                     }
                 }
             }
-        }
-    }
-
-    /* Update scope stack for the current function declaration
-    Semantic checks:
-    8. No return statement in a non-void function.
-    9. A void function can't return a value.
-    10. A non-void function must return a value. Note that you're only checking for the existence of an appropriate return statement at the semantic checking stage, not whether it's actually executed.
-    11. A value returned from a function has the wrong type.
-    */
-    else if (node->getNodeType() == "maindecl" || node->getNodeType() == "funcdecl") {
-        if (before) {
-            unordered_map<string, entry>* ptr = scopeStack.at(1)->at(node->getName()).symTable;
-            scopeStack.push_back(ptr);
-            scope++;
-
-            string returnType = node->getType();
-            bool retStmt = false;
-            for (auto child : node->getChildren()) {
-                if (child->getNodeType() == "block") {
-                    for (auto blockChild : child->getChildren()) {
-                        if (retStmt == false) {
-                            retStmt = checkForReturn(blockChild, returnType);
-                        }
-                    }
+            break;
+        }
+
+        case NodeKind::MAIN_DECL:
+        case NodeKind::FUNC_DECL:
+            checkReturns(node, out);
+            break;
+
+        //12. An if- or while-condition must be of Boolean type.
+        case NodeKind::IF_STMT:
+        case NodeKind::WHILE_STMT: {
+            AST* child = node->getChild(0);
+            Type type = typeCheck(child, out);
+            if (type != Type::BOOLEAN) {
+                if (node->getKind() == NodeKind::IF_STMT) {
+                    out << "Error: If condition statement not of boolean type near line: " << node->getLineNo() << ". " << endl;
+                    errors++;
                 }
-            }
-            if (retStmt == false) {
-                //8. No return statement in a non-void function.
-                if ((returnType == "int") || (returnType == "boolean")) {
-                    cerr << "Error: Non-void function of type " << returnType << " does not return a value near line: " << node->getLineNo() << ". " << endl;
-                    errors++;                    
+                else {
+                    out << "Error: While condition statement not of boolean type near line: " << node->getLineNo() << ". " << endl;
+                    errors++;
                 }
             }
-
+            break;
         }
-        else {
-            scope--;
-            scopeStack.pop_back();
+
+        case NodeKind::ASSN_STMT: {
+            Type varType = declType(node);
+            Type assnType = typeCheck(node->getChild(1), out);
+            if (varType != assnType) {
+                    out << "Error: Variable type " << typeName(varType) << " does not match assignment type " << typeName(assnType) << " near line: " << node->getLineNo() << ". " << endl;
+                    errors++;            
+            }
+            break;
         }
+
+        default:
+            break;
     }
-    //12. An if- or while-condition must be of Boolean type.
-    else if (before && (node->getNodeType() == "if" || node->getNodeType() == "while")) {
-        AST* child = node->getChildren().at(0);
-        string type = typeCheck(child);
-        if (type != "boolean") {
-            if (node->getNodeType() == "if") {
-                cerr << "Error: If condition statement not of boolean type near line: " << node->getLineNo() << ". " << endl;
-                errors++;
-            }
-            else {
-                cerr << "Error: While condition statement not of boolean type near line: " << node->getLineNo() << ". " << endl;
-                errors++;
+}
+
+/*
+Semantic checks:
+8. No return statement in a non-void function.
+9. A void function can't return a value.
+10. A non-void function must return a value. Note that you're only checking for the existence of an appropriate return statement at the semantic checking stage, not whether it's actually executed.
+11. A value returned from a function has the wrong type.
+*/
+inline void TypePass::checkReturns(AST* func, ostream& out) {
+    Type returnType = typeOf(func->getType());
+    bool retStmt = false;
+    for (AST* child : func->getChildren()) {
+        if (child->getKind() == NodeKind::BLOCK) {
+            for (AST* blockChild : child->getChildren()) {
+                // Only the returns up to the first statement that has one are
+                // matched against the function, the values of the rest are still typed
+                bool found = checkForReturn(blockChild, returnType, !retStmt, out);
+                retStmt = retStmt || found;
             }
         }
     }
-
-    else if (before && (node->getNodeType() == "assnstmt")) {
-        string varType = getIdType(node->getName());
-        string assnType = typeCheck(node->getChildren().at(1));
-        if (varType != assnType) {
-                cerr << "Error: Variable type " << varType << " does not match assignment type " << assnType << " near line: " << node->getLineNo() << ". " << endl;
-                errors++;            
+    if (retStmt == false) {
+        //8. No return statement in a non-void function.
+        if ((returnType == Type::INT) || (returnType == Type::BOOLEAN)) {
+            out << "Error: Non-void function of type " << typeName(returnType) << " does not return a value near line: " << func->getLineNo() << ". " << endl;
+            errors++;                    
         }
     }
-    return node;
-};
+}
 
-inline AST* fourthPass(AST* node) {
-    //6. Break statements must be inside a while statement.
-    if (before) {
-        if (node->getNodeType() == "while") {
+inline void BreakPass::enter(AST* node) {
+    switch (node->getKind()) {
+        case NodeKind::WHILE_STMT:
             whileLoops ++;
-        }
-        else if (node->getNodeType() == "break") {
+            break;
+
+        case NodeKind::BREAK_STMT:
             if (whileLoops < 1) {
-                cerr << "Error: Break statemenout outside while statement near line: " << node->getLineNo() << ". " << endl;
+                out << "Error: Break statemenout outside while statement near line: " << node->getLineNo() << ". " << endl;
                 errors++;  
             }
-        }
-    }
-    else {
-        if (node->getNodeType() == "while") {
-            whileLoops --;
-        }
+            break;
+
+        default:
+            break;
     }
+}
 
-    return node;
-};
+inline void BreakPass::leave(AST* node) {
+    if (node->getKind() == NodeKind::WHILE_STMT) {
+        whileLoops --;
+    }
+}
 
 // Adds the j-- library functions to the symbol table at scope stack 0 so
 // that these functions are always in scope
 inline void addPreDefined() {
     // Entry for getChar function
-    entry getChar = {.scope = 0, .type = "int", .symTable = &symTables[29]};
-    symTables[0].insert({"getchar", getChar});
+    entry getChar = {.scope = 0, .type = Type::INT, .signature = symbols.addSignature({Type::INT, {}})};
+    symbols.insert(LIBRARY_SCOPE, SYM_GETCHAR, getChar);
 
     // Entry for halt function
-    entry halt = {.scope = 0, .type = "void", .symTable = &symTables[29]};
-    symTables[0].insert({"halt", halt});
+    entry halt = {.scope = 0, .type = Type::VOID, .signature = symbols.addSignature({Type::VOID, {}})};
+    symbols.insert(LIBRARY_SCOPE, SYM_HALT, halt);
 
     // Entry for printb function
-    unordered_map<string, entry> printbTable;
-    entry printbParam = {.scope = 1, .paramNum = 1, .type = "boolean"};
-    printbTable.insert({"b", printbParam});
-    symTables[symIt] = printbTable;
-    entry printb = {.scope = 0, .type = "void", .symTable = &symTables[symIt]};
-    symTables[0].insert({"printb", printb});
-    symIt++;
+    entry printb = {.scope = 0, .type = Type::VOID, .signature = symbols.addSignature({Type::VOID, {Type::BOOLEAN}})};
+    symbols.insert(LIBRARY_SCOPE, SYM_PRINTB, printb);
 
     // Entry for printc function
-    unordered_map<string, entry> printcTable;
-    entry printcParam = {.scope = 1, .paramNum = 1, .type = "int"};
-    printcTable.insert({"c", printcParam});
-    symTables[symIt] = printcTable;
-    entry printc = {.scope = 0, .type = "void", .symTable = &symTables[symIt]};
-    symTables[0].insert({"printc", printc});
-    symIt++;
+    entry printc = {.scope = 0, .type = Type::VOID, .signature = symbols.addSignature({Type::VOID, {Type::INT}})};
+    symbols.insert(LIBRARY_SCOPE, SYM_PRINTC, printc);
 
     // Entry for printi function
-    unordered_map<string, entry> printiTable;
-    entry printiParam = {.scope = 1, .paramNum = 1, .type = "int"};
-    printiTable.insert({"i", printcParam});
-    symTables[symIt] = printiTable;
-    entry printi = {.scope = 0, .type = "void", .symTable = &symTables[symIt] };
-    symTables[0].insert({"printi", printi});
-    symIt++;
+    entry printi = {.scope = 0, .type = Type::VOID, .signature = symbols.addSignature({Type::VOID, {Type::INT}})};
+    symbols.insert(LIBRARY_SCOPE, SYM_PRINTI, printi);
 
     // Entry for prints function
-    unordered_map<string, entry> printsTable;
-    entry printsParam = {.scope = 1, .paramNum = 1, .type = "string"};
-    printsTable.insert({"s", printsParam});
-    symTables[symIt] = printsTable;
-    entry prints = {.scope = 0, .type = "void", .symTable = &symTables[symIt] };
-    symTables[0].insert({"prints", prints});
-    symIt++;
+    entry prints = {.scope = 0, .type = Type::VOID, .signature = symbols.addSignature({Type::VOID, {Type::STRING}})};
+    symbols.insert(LIBRARY_SCOPE, SYM_PRINTS, prints);
 };
 
-// Checks the global scopeStack for main functions
-inline void checkForMain(unordered_map<string, entry> global) {
-    int mains = 0;
-
-    for (auto& ent : global) {
-        if (ent.second.nodeType == "maindecl") {
-            mains++;
-        }
-    }
+// Checks the number of main functions declared in the global scope
+inline void checkForMain(int mains) {
     if (mains == 0) {
         cerr << "Error: No main function found." << endl;
         errors++;
@@ -463,139 +666,197 @@ inline void checkForMain(unordered_map<string, entry> global) {
     }
 }
 
-// Takes as input the name of an identifier, searches for it in the 
-// scope stack, and returns its type as a string
-inline string getIdType(string name) {
-    int size = scopeStack.size() - 1;
-    for (int i = size; i >= 0; i--) {
-        auto it = scopeStack.at(i)->find(name);
-        if (it != scopeStack.at(i)->end()) {
-            return it->second.type;
-        }    
-    }
-    return "";
+// Takes as input the name of an identifier, searches for it in the
+// scope stack, and returns the entry of its innermost declaration
+inline entry* resolve(Symbol name) {
+    for (int i = scopeStack.size() - 1; i >= 0; i--) {
+        entry* found = tableOf(scopeStack[i]).find(scopeStack[i], name);
+        if (found != nullptr) {
+            return found;
+        }
+    }
+    return nullptr;
 }
 
-//Returns the type of given node, and recursively checks the left and right side
-//of operations and returns error messages if their types are wrong.
-inline string typeCheck(AST* node) {
-    string nodeType = node->getNodeType();
-    if (nodeType == "literal") {
-        return "boolean";
-    }
-    else if (nodeType == "string") {
-        return "string";
-    }
-    else if (nodeType == "num") {
-        return "int";
-    }
-    else if ((nodeType == "id") || nodeType == "funccall") {
-        return getIdType(node->getName());
-    }
-    else if (nodeType == "funccall") {
-        return node->getType();
-    }
-    else if (nodeType == "compare") {
-        string left = typeCheck(node->getChildren().at(0));
-        string right = typeCheck(node->getChildren().at(1));
-        if (!(node->getType() == "==") && !(node->getType() == "!=")) {
-            if (left != "int") {
-                cerr << "Error: Bad type used in compare operation near line: " << node->getLineNo() << ". " << "Type " << left << " used instead of int." << endl;
-                errors++;            
-            }
-            if (right != "int") {
-                cerr << "Error: Bad type used in compare operation near line: " << node->getLineNo() << ". " << "Type " << right << " used instead of int." << endl;
-                errors++;    
-            }
+// Returns the table the names of a scope are declared in
+inline SymbolTable& tableOf(ScopeId scope) {
+    return scope > GLOBAL_SCOPE ? *localSymbols : symbols;
+}
+
+// Returns the type of the declaration a node was resolved to, or NONE if it
+// doesn't refer to one
+inline Type declType(AST* node) {
+    return node->getDecl() != nullptr ? node->getDecl()->type : Type::NONE;
+}
+
+// Type check state of one operator node: the operand being checked next
+struct TypeFrame {
+    AST* node;
+    int operand;
+};
+
+//Returns the type of given node, and checks the left and right side of
+//operations and returns error messages if their types are wrong. Operands are
+//checked in the same order as a recursive walk would, but with an explicit
+//stack of operator nodes and a stack of the operand types found so far.
+//The type of every node is kept on it, so a subtree that was already checked
+//just gives its type back without being walked or reporting anything again.
+inline Type typeCheck(AST* root, ostream& out) {
+    vector<TypeFrame> frames;
+    vector<Type> types;
+    AST* node = root;
+    while (true) {
+        // Descend to the leftmost operand, leaves push their type directly
+        if (node->getExprType() != Type::UNCHECKED) {
+            types.push_back(node->getExprType());
         }
         else {
-            if (left != right) {
-                cerr << "Error: Trying to compare type " << left << " to type " << right << " near line " << node->getLineNo() << "." << endl;
-                errors++; 
+            Type type;
+            switch (node->getKind()) {
+                case NodeKind::LITERAL:
+                    type = Type::BOOLEAN;
+                    break;
+                case NodeKind::STRING_LIT:
+                    type = Type::STRING;
+                    break;
+                case NodeKind::NUM:
+                    type = Type::INT;
+                    break;
+                case NodeKind::ID:
+                case NodeKind::FUNC_CALL:
+                    type = declType(node);
+                    break;
+                case NodeKind::COMPARE:
+                case NodeKind::LOGICAL:
+                case NodeKind::ARITHMETIC:
+                    frames.push_back({node, 0});
+                    node = node->getChild(0);
+                    continue;
+                default:
+                    type = Type::NONE;
+                    break;
             }
-        }
-        return "boolean";
-    }
-    else if (nodeType == "logical") {
-        string left = typeCheck(node->getChildren().at(0));
-        if (left != "boolean") {
-            cerr << "Error: Bad type used in logical operation near line: " << node->getLineNo() << ". " << "Type " << left << " used instead of boolean." << endl;
-            errors++;            
-        }
-        if (node->getChildren().size() > 1) {
-            string right = typeCheck(node->getChildren().at(1));
-            if (right != "boolean") {
-                cerr << "Error: Bad type used in logical operation near line: " << node->getLineNo() << ". " << "Type " << right << " used instead of boolean." << endl;
-                errors++;    
+            node->setExprType(type);
+            types.push_back(type);
+        }
+
+        // Finish every operator whose operands are all checked, or move on to its next operand
+        node = nullptr;
+        while (!frames.empty() && node == nullptr) {
+            TypeFrame& frame = frames.back();
+            AST* op = frame.node;
+            frame.operand++;
+            switch (op->getKind()) {
+                case NodeKind::COMPARE: {
+                    if (frame.operand == 1) {
+                        node = op->getChild(1);
+                        break;
+                    }
+                    Type right = types.back();
+                    types.pop_back();
+                    Type left = types.back();
+                    types.pop_back();
+                    if (!(op->getType() == "==") && !(op->getType() == "!=")) {
+                        if (left != Type::INT) {
+                            out << "Error: Bad type used in compare operation near line: " << op->getLineNo() << ". " << "Type " << typeName(left) << " used instead of int." << endl;
+                            errors++;            
+                        }
+                        if (right != Type::INT) {
+                            out << "Error: Bad type used in compare operation near line: " << op->getLineNo() << ". " << "Type " << typeName(right) << " used instead of int." << endl;
+                            errors++;    
+                        }
+                    }
+                    else {
+                        if (left != right) {
+                            out << "Error: Trying to compare type " << typeName(left) << " to type " << typeName(right) << " near line " << op->getLineNo() << "." << endl;
+                            errors++; 
+                        }
+                    }
+                    op->setExprType(Type::BOOLEAN);
+                    types.push_back(Type::BOOLEAN);
+                    frames.pop_back();
+                    break;
+                }
+                case NodeKind::LOGICAL:
+                case NodeKind::ARITHMETIC: {
+                    bool logical = op->getKind() == NodeKind::LOGICAL;
+                    Type expected = logical ? Type::BOOLEAN : Type::INT;
+                    Type operandType = types.back();
+                    types.pop_back();
+                    if (operandType != expected) {
+                        out << "Error: Bad type used in " << (logical ? "logical" : "arithmetic") << " operation near line: " << op->getLineNo() << ". " << "Type " << typeName(operandType) << " used instead of " << typeName(expected) << "." << endl;
+                        errors++;            
+                    }
+                    if (frame.operand < op->numChildren()) {
+                        node = op->getChild(frame.operand);
+                        break;
+                    }
+                    op->setExprType(expected);
+                    types.push_back(expected);
+                    frames.pop_back();
+                    break;
+                }
+                default:
+                    break;
             }
         }
-        return "boolean";
-    }
-    else if (nodeType == "arithmetic") {
-        string left = typeCheck(node->getChildren().at(0));
-        if (left != "int") {
-            cerr << "Error: Bad type used in arithmetic operation near line: " << node->getLineNo() << ". " << "Type " << left << " used instead of int." << endl;
-            errors++;            
+        if (node == nullptr) {
+            return types.back();
         }
-        if (node->getChildren().size() > 1) {        
-            string right = typeCheck(node->getChildren().at(1));
-            if (right != "int") {
-                cerr << "Error: Bad type used in arithmetic operation near line: " << node->getLineNo() << ". " << "Type " << right << " used instead of int." << endl;
-                errors++;    
-            }
-        }
-        return "int";
     }
-    return "";
 }
 
-// Recursively checks for return statements inside a function, returns
-// true if it finds a return statement.
-inline bool checkForReturn(AST* node, string returnType) {
+// Checks for return statements inside a function, returns true if it finds
+// a return statement. Nodes are visited in preorder from an explicit stack.
+// Unless matchType is set the values returned are only type checked themselves.
+inline bool checkForReturn(AST* root, Type returnType, bool matchType, ostream& out) {
     bool retStmt = false;
-    if (node->getNodeType() == "return") {
-        retStmt = true;
-        if (node->getChildren().empty()) {
-            //10. A non-void function must return a value.
-            if (returnType == "int" || returnType == "boolean") {
-                cerr << "Error: Non-void function of type " << returnType << " does not return a value near line: " << node->getLineNo() << ". " << endl;
-                errors++;
+    vector<AST*> pending = {root};
+    while (!pending.empty()) {
+        AST* node = pending.back();
+        pending.pop_back();
+        if (node->getKind() == NodeKind::RET_STMT) {
+            retStmt = true;
+            if (!matchType) {
+                if (node->numChildren() > 0) {
+                    typeCheck(node->getChild(0), out);
+                }
             }
-        }
-        else {
-            string retValue = node->getChildren().at(0)->getType();
-            if (retValue == "") {
-                retValue = getIdType(node->getChildren().at(0)->getName());
-                if (retValue == "") {
-                    cerr << "Error: Function returns undeclared variable " << node->getChildren().at(0)->getName() << " near line: " << node->getLineNo() << ". " << endl;
+            else if (node->numChildren() == 0) {
+                //10. A non-void function must return a value.
+                if (returnType == Type::INT || returnType == Type::BOOLEAN) {
+                    out << "Error: Non-void function of type " << typeName(returnType) << " does not return a value near line: " << node->getLineNo() << ". " << endl;
                     errors++;
                 }
             }
-
-            //9. A void function can't return a value.
-            if (returnType == "void") {
-                cerr << "Error: Void function returns non-void type " << retValue << " near line: " << node->getLineNo() << ". " << endl;
-                errors++;
-            }
-            //9. A void function can't return a value.
-            else if (returnType == "") {
-                cerr << "Error: Main function returns non-void type " << retValue << " near line: " << node->getLineNo() << ". " << endl;
-                errors++;
-            }
-            //11. A value returned from a function has the wrong type.
             else {
-                if (!(returnType == retValue)) {
-                cerr << "Error: Non-void function returns type " << retValue << " when it should return type " << returnType << " near line: " << node->getLineNo() << ". " << endl;
-                errors++;
+                Type retValue = typeCheck(node->getChild(0), out);
+                if (retValue == Type::NONE) {
+                    out << "Error: Function returns undeclared variable " << node->getChild(0)->getName() << " near line: " << node->getLineNo() << ". " << endl;
+                    errors++;
+                }
+
+                //9. A void function can't return a value.
+                if (returnType == Type::VOID) {
+                    out << "Error: Void function returns non-void type " << typeName(retValue) << " near line: " << node->getLineNo() << ". " << endl;
+                    errors++;
+                }
+                //9. A void function can't return a value.
+                else if (returnType == Type::NONE) {
+                    out << "Error: Main function returns non-void type " << typeName(retValue) << " near line: " << node->getLineNo() << ". " << endl;
+                    errors++;
+                }
+                //11. A value returned from a function has the wrong type.
+                else {
+                    if (returnType != retValue) {
+                    out << "Error: Non-void function returns type " << typeName(retValue) << " when it should return type " << typeName(returnType) << " near line: " << node->getLineNo() << ". " << endl;
+                    errors++;
+                    }
                 }
             }
         }
-    }
-    bool rt;
-    for (auto child : node->getChildren()) {
-        rt = checkForReturn(child, returnType);
-        if (retStmt == false) {
-            retStmt = rt;
+        for (int i = node->numChildren(); i --> 0;) {
+            pending.push_back(node->getChild(i));
         }
     }
     return retStmt;
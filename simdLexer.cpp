@@ -0,0 +1,373 @@
+/*
+Hand-written j-- scanner. Produces exactly the tokens, values, line numbers and
+warnings of the flex scanner in scanner.l, see simdLexer.hpp.
+
+The bulk scans (blanks, comments, string bodies) compare a whole vector of source
+bytes against the interesting characters and turn the result into a bit mask, so
+the position of the first stop character is a count of trailing zeros. SSE2 is
+always available on x86-64, AVX2 is used when the compiler targets it (-mavx2).
+Other targets and the last partial vector of the buffer use the scalar loops.
+*/
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include "parser.hh"
+#include "simdLexer.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SIMD_WIDTH 32
+typedef __m256i Vec;
+static inline Vec loadVec(const char *p) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+}
+// Bit i of the result is set when byte i of v equals c
+static inline uint32_t matches(Vec v, char c) {
+    return _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(c)));
+}
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define SIMD_WIDTH 16
+typedef __m128i Vec;
+static inline Vec loadVec(const char *p) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+static inline uint32_t matches(Vec v, char c) {
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(c)));
+}
+#endif
+
+using Token = JCC::Parser::token;
+
+/*
+Skips spaces, tabs, carriage returns and newlines. Returns the first other byte,
+counts the newlines passed and points lineStart just after the last of them.
+*/
+static const char *skipBlanks(const char *p, const char *end, int &newlines, const char *&lineStart) {
+    // Tokens are mostly separated by nothing or by a single space, which is not worth a vector load
+    if (p < end && *p == ' ') {
+        p++;
+    }
+    if (p == end || (*p != ' ' && *p != '\t' && *p != '\r' && *p != '\n')) {
+        return p;
+    }
+#ifdef SIMD_WIDTH
+    while (end - p >= SIMD_WIDTH) {
+        Vec v = loadVec(p);
+        uint32_t nl = matches(v, '\n');
+        uint32_t blank = nl | matches(v, ' ') | matches(v, '\t') | matches(v, '\r');
+        uint32_t stop = ~blank;
+#if SIMD_WIDTH == 16
+        stop &= 0xFFFF;
+#endif
+        if (stop != 0) {
+            int idx = __builtin_ctz(stop);
+            nl &= (1u << idx) - 1;
+            p += idx;
+            if (nl != 0) {
+                newlines += __builtin_popcount(nl);
+                lineStart = p - idx + (32 - __builtin_clz(nl));
+            }
+            return p;
+        }
+        if (nl != 0) {
+            newlines += __builtin_popcount(nl);
+            lineStart = p + (32 - __builtin_clz(nl));
+        }
+        p += SIMD_WIDTH;
+    }
+#endif
+    for (; p < end; p++) {
+        if (*p == '\n') {
+            newlines++;
+            lineStart = p + 1;
+        }
+        else if (*p != ' ' && *p != '\t' && *p != '\r') {
+            break;
+        }
+    }
+    return p;
+}
+
+// Finds the newline that ends a // comment, or the end of the buffer
+static const char *findNewline(const char *p, const char *end) {
+#ifdef SIMD_WIDTH
+    while (end - p >= SIMD_WIDTH) {
+        uint32_t nl = matches(loadVec(p), '\n');
+        if (nl != 0) {
+            return p + __builtin_ctz(nl);
+        }
+        p += SIMD_WIDTH;
+    }
+#endif
+    while (p < end && *p != '\n') {
+        p++;
+    }
+    return p;
+}
+
+// Finds the next byte of a string body that needs a look: a quote, a backslash or a newline
+static const char *findStringStop(const char *p, const char *end) {
+#ifdef SIMD_WIDTH
+    while (end - p >= SIMD_WIDTH) {
+        Vec v = loadVec(p);
+        uint32_t stop = matches(v, '"') | matches(v, '\\') | matches(v, '\n');
+        if (stop != 0) {
+            return p + __builtin_ctz(stop);
+        }
+        p += SIMD_WIDTH;
+    }
+#endif
+    while (p < end && *p != '"' && *p != '\\' && *p != '\n') {
+        p++;
+    }
+    return p;
+}
+
+// Characters that may follow a backslash in a string without ending it, as in scanner.l
+static bool isEscape(char c) {
+    return c == '\b' || c == '\f' || c == '\t' || c == '\r' || c == '\n' || c == '\'' || c == '"' || c == '\\' || c == '\0';
+}
+
+static bool isIdChar(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+// Token type of a keyword, or T_ID
+static int keyword(const char *str, size_t len) {
+    switch (len) {
+        case 2:
+            if (memcmp(str, "if", 2) == 0) return Token::T_IF;
+            break;
+        case 3:
+            if (memcmp(str, "int", 3) == 0) return Token::T_INT;
+            break;
+        case 4:
+            if (memcmp(str, "true", 4) == 0) return Token::T_TRUE;
+            if (memcmp(str, "void", 4) == 0) return Token::T_VOID;
+            if (memcmp(str, "else", 4) == 0) return Token::T_ELSE;
+            break;
+        case 5:
+            if (memcmp(str, "false", 5) == 0) return Token::T_FALSE;
+            if (memcmp(str, "while", 5) == 0) return Token::T_WHILE;
+            if (memcmp(str, "break", 5) == 0) return Token::T_BREAK;
+            break;
+        case 6:
+            if (memcmp(str, "return", 6) == 0) return Token::T_RETURN;
+            break;
+        case 7:
+            if (memcmp(str, "boolean", 7) == 0) return Token::T_BOOL;
+            break;
+    }
+    return Token::T_ID;
+}
+
+JCC::SimdLexer::SimdLexer(std::istream *in) : Lexer(in) {
+    std::string text;
+    char block[64 * 1024];
+    while (in->read(block, sizeof(block)) || in->gcount() > 0) {
+        text.append(block, in->gcount());
+    }
+    char *copy = static_cast<char*>(AST::arena->allocate(text.size(), 1));
+    memcpy(copy, text.data(), text.size());
+    cur = copy;
+    end = copy + text.size();
+}
+
+JCC::SimdLexer::SimdLexer(const SourceFile *src) : Lexer(src) {
+    cur = src->data();
+    end = cur + src->size();
+}
+
+int JCC::SimdLexer::yylex(JCC::Parser::semantic_type *yylval, JCC::Parser::location_type *loc) {
+    for (;;) {
+        int newlines = 0;
+        const char *lineStart = nullptr;
+        const char *start = cur;
+        cur = skipBlanks(cur, end, newlines, lineStart);
+        if (newlines > 0) {
+            yylineno += newlines;
+            linewarnings = 0;
+            loc->lines(newlines);
+            loc->columns(cur - lineStart);
+        }
+        else {
+            loc->columns(cur - start);
+        }
+        loc->step();
+        if (cur == end) {
+            return 0;
+        }
+
+        start = cur;
+        char c = *cur++;
+        char next = cur < end ? *cur : '\0';
+        int token;
+        switch (c) {
+            case '/':
+                if (next == '/') {
+                    // The newline is left for skipBlanks to count
+                    cur = findNewline(cur + 1, end);
+                    loc->columns(cur - start);
+                    continue;
+                }
+                token = Token::T_DIV;
+                break;
+            case '"':
+                return scanString(yylval, loc);
+            case '+': token = Token::T_ADD; break;
+            case '-': token = Token::T_SUB; break;
+            case '*': token = Token::T_MULT; break;
+            case '%': token = Token::T_MOD; break;
+            case '(': token = Token::T_OPENPAR; break;
+            case ')': token = Token::T_CLOSEPAR; break;
+            case '{': token = Token::T_OPENBRACE; break;
+            case '}': token = Token::T_CLOSEBRACE; break;
+            case ';': token = Token::T_SEMICOLON; break;
+            case ',': token = Token::T_COMMA; break;
+            case '<':
+                token = next == '=' ? Token::T_LE : Token::T_LT;
+                break;
+            case '>':
+                token = next == '=' ? Token::T_GE : Token::T_GT;
+                break;
+            case '=':
+                token = next == '=' ? Token::T_EQ : Token::T_ASSIGN;
+                break;
+            case '!':
+                token = next == '=' ? Token::T_NEQ : Token::T_NOT;
+                break;
+            case '&':
+            case '|':
+                if (next != c) {
+                    badCharacter(yylineno);
+                    loc->columns(1);
+                    continue;
+                }
+                token = c == '&' ? Token::T_AND : Token::T_OR;
+                break;
+            default:
+                if (c >= '0' && c <= '9') {
+                    while (cur < end && *cur >= '0' && *cur <= '9') {
+                        cur++;
+                    }
+                    size_t len = cur - start;
+                    // Up to 9 digits always fit, longer numbers go through std::stoi to fail the same way as flex
+                    if (len <= 9) {
+                        int value = 0;
+                        for (const char *p = start; p < cur; p++) {
+                            value = value * 10 + (*p - '0');
+                        }
+                        yylval->ival = value;
+                    }
+                    else {
+                        yylval->ival = std::stoi(std::string(start, len));
+                    }
+                    loc->columns(len);
+                    return Token::T_NUM;
+                }
+                if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_') {
+                    while (cur < end && isIdChar(*cur)) {
+                        cur++;
+                    }
+                    size_t len = cur - start;
+                    loc->columns(len);
+                    token = keyword(start, len);
+                    if (token == Token::T_ID) {
+                        // The source buffer lives as long as the compilation
+                        yylval->sym = interner.internStable(start, len);
+                    }
+                    return token;
+                }
+                badCharacter(yylineno);
+                loc->columns(1);
+                continue;
+        }
+        // Two character operators
+        if (token == Token::T_LE || token == Token::T_GE || token == Token::T_EQ || token == Token::T_NEQ
+                || token == Token::T_AND || token == Token::T_OR) {
+            cur++;
+        }
+        loc->columns(cur - start);
+        return token;
+    }
+}
+
+/* Scans a string literal whose opening quote has been consumed */
+int JCC::SimdLexer::scanString(JCC::Parser::semantic_type *yylval, JCC::Parser::location_type *loc) {
+    const char *start = cur - 1;
+    for (;;) {
+        cur = findStringStop(cur, end);
+        if (cur == end) {
+            std::cerr << "ERROR: string literal opened but never closed at line " << yylineno << std::endl;
+            warnings++;
+            linewarnings++;
+            loc->columns(cur - start);
+            loc->step();
+            return 0;
+        }
+        if (*cur == '"') {
+            cur++;
+            loc->columns(cur - start);
+            yylval->str = {start, static_cast<uint32_t>(cur - start)};
+            return Token::T_STRING;
+        }
+        if (*cur == '\\') {
+            if (cur + 1 < end && isEscape(cur[1])) {
+                // An escaped newline continues the string, flex counts it in yylineno only
+                if (cur[1] == '\n') {
+                    yylineno++;
+                }
+                cur += 2;
+            }
+            else {
+                cur++;
+            }
+            continue;
+        }
+        // Flex counts the newline before running the action
+        yylineno++;
+        std::cerr << "ERROR: newline in string at line " << yylineno << std::endl;
+        warnings++;
+        linewarnings++;
+        cur++;
+        loc->lines();
+        loc->step();
+        skipBadString(loc);
+        return yylex(yylval, loc);
+    }
+}
+
+/* Skips the rest of a string that contained a newline, up to its closing quote */
+void JCC::SimdLexer::skipBadString(JCC::Parser::location_type *loc) {
+    const char *lineStart = cur;
+    for (;;) {
+        cur = findStringStop(cur, end);
+        if (cur == end) {
+            loc->columns(cur - lineStart);
+            loc->step();
+            return;
+        }
+        char c = *cur++;
+        if (c == '"') {
+            loc->columns(cur - lineStart);
+            loc->step();
+            return;
+        }
+        if (c == '\n') {
+            yylineno++;
+            loc->lines();
+            loc->step();
+            lineStart = cur;
+        }
+    }
+}
+
+std::unique_ptr<JCC::Lexer> createSimdLexer(std::istream* input) {
+    return std::make_unique<JCC::SimdLexer>(input);
+}
+
+std::unique_ptr<JCC::Lexer> createSimdLexer(const SourceFile& source) {
+    return std::make_unique<JCC::SimdLexer>(&source);
+}
@@ -0,0 +1,37 @@
+#ifndef SIMD_LEXER_HPP
+#define SIMD_LEXER_HPP
+
+#include "scanner.hpp"
+
+namespace JCC{
+    /*
+    Hand-written scanner for the same tokens as scanner.l, selected with --lexer=simd.
+    It scans the whole source in place instead of running the flex DFA one character
+    at a time: whitespace, // comments and string bodies are skipped 16 bytes at a
+    time with SSE2 (32 with AVX2) and identifiers and string literals are views into
+    the source buffer.
+    */
+    class SimdLexer : public Lexer {
+        public:
+
+        // Reads the whole stream into the AST arena up front
+        SimdLexer(std::istream *in);
+
+        // Scans the mapped file directly
+        SimdLexer(const SourceFile *src);
+
+        int yylex(JCC::Parser::semantic_type *yylval, JCC::Parser::location_type *location) override;
+
+        private:
+        const char *cur = nullptr;
+        const char *end = nullptr;
+
+        int scanString(JCC::Parser::semantic_type *yylval, JCC::Parser::location_type *location);
+        void skipBadString(JCC::Parser::location_type *location);
+    };
+}
+
+std::unique_ptr<JCC::Lexer> createSimdLexer(std::istream* input);
+std::unique_ptr<JCC::Lexer> createSimdLexer(const SourceFile& source);
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef SOURCE_HPP
+#define SOURCE_HPP
+
+#include <cstddef>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "intern.hpp"
+
+/*
+Source file mapped read-only into memory. The mapping stays alive for the
+whole compilation, so tokens can refer to identifiers and string literals
+with views into it instead of copying them.
+*/
+class SourceFile
+{
+    private:
+    const char *bytes = "";
+    size_t length = 0;
+    bool mapped = false;
+
+    public:
+    SourceFile() = default;
+    SourceFile(const SourceFile&) = delete;
+    SourceFile& operator=(const SourceFile&) = delete;
+
+    ~SourceFile() {
+        if (mapped) {
+            munmap(const_cast<char*>(bytes), length);
+        }
+    }
+
+    // Maps the file at path, returns false and leaves errno set on failure
+    bool open(const char *path) {
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            ::close(fd);
+            return false;
+        }
+        length = st.st_size;
+        // An empty file can't be mapped, it keeps the empty string as its contents
+        if (length > 0) {
+            void *ptr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (ptr == MAP_FAILED) {
+                ::close(fd);
+                return false;
+            }
+            madvise(ptr, length, MADV_SEQUENTIAL);
+            bytes = static_cast<const char*>(ptr);
+            mapped = true;
+        }
+        ::close(fd);
+        return true;
+    }
+
+    const char *data() const {
+        return bytes;
+    }
+
+    size_t size() const {
+        return length;
+    }
+
+    StrRef view(size_t offset, size_t len) const {
+        return {bytes + offset, static_cast<uint32_t>(len)};
+    }
+};
+
+#endif
@@ -0,0 +1,148 @@
+#ifndef SYMBOL_TABLE_HPP
+#define SYMBOL_TABLE_HPP
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+#include "ast.hpp"
+
+// Scope a symbol is declared in. Every function gets a scope of its own for its
+// parameters and locals, after the library functions' scope and the global scope.
+typedef uint32_t ScopeId;
+const ScopeId LIBRARY_SCOPE = 0;
+const ScopeId GLOBAL_SCOPE = 1;
+
+// Signature of a function, made once from its declaration: the return type and
+// the types of the parameters in order
+struct Signature {
+    Type returnType;
+    std::vector<Type> params;
+};
+
+// Symbol table entry. The name resolution in the semantic analyzer points every
+// identifier, assignment and call at the entry of its declaration.
+struct entry {
+    int scope;          // Nesting level: 0 for the library, 1 for globals, 2 for locals
+    int paramNum;       // Position of a parameter, 0 for anything else
+    Type type;
+    NodeKind nodeType;
+    ScopeId symTable;   // Scope of a function's parameters and locals
+    const Signature* signature = nullptr;   // Signature of a function
+    int location = -1;  // IR value of a local, data label of a global, given by the code generator
+};
+
+/*
+Symbol table of a whole compilation. The entries of all scopes live in one open
+addressing hash table keyed on (scope, symbol), so a lookup is a hash and a short
+linear probe whatever the number of functions, and no scope has a table of its own
+to allocate. The entries themselves are kept apart from the hash table and never
+move, so the AST can point at them. They stay after their scope has been walked,
+since the type checker and the code generator look at the parameters of any function.
+The table also keeps the signatures of the functions.
+*/
+class SymbolTable
+{
+    private:
+    struct Slot {
+        ScopeId scope;
+        Symbol name;        // NO_SYMBOL marks an empty slot
+        entry* value;
+    };
+
+    std::vector<Slot> slots;
+    std::deque<entry> entries;
+    std::deque<Signature> signatures;
+    size_t signatureBytes = 0;
+    size_t mask = 0;
+    size_t used = 0;
+    ScopeId scopes = 0;
+
+    static size_t hash(ScopeId scope, Symbol name) {
+        uint64_t key = (static_cast<uint64_t>(scope) << 32) | name;
+        return (key * 0x9E3779B97F4A7C15ull) >> 32;
+    }
+
+    void grow() {
+        std::vector<Slot> old;
+        old.swap(slots);
+        slots.assign(old.empty() ? 256 : old.size() * 2, Slot{0, NO_SYMBOL, nullptr});
+        mask = slots.size() - 1;
+        for (Slot& slot : old) {
+            if (slot.name != NO_SYMBOL) {
+                size_t i = hash(slot.scope, slot.name) & mask;
+                while (slots[i].name != NO_SYMBOL) {
+                    i = (i + 1) & mask;
+                }
+                slots[i] = slot;
+            }
+        }
+    }
+
+    public:
+    SymbolTable() {
+        newScope();
+        newScope();
+    }
+
+    ScopeId newScope() {
+        return scopes++;
+    }
+
+    // Keeps a signature for the rest of the compilation
+    const Signature* addSignature(const Signature& signature) {
+        signatures.push_back(signature);
+        signatureBytes += sizeof(Signature) + signatures.back().params.capacity() * sizeof(Type);
+        return &signatures.back();
+    }
+
+    // Returns the entry of name in the given scope, or nullptr
+    entry* find(ScopeId scope, Symbol name) {
+        if (slots.empty()) {
+            return nullptr;
+        }
+        size_t i = hash(scope, name) & mask;
+        while (slots[i].name != NO_SYMBOL) {
+            if (slots[i].name == name && slots[i].scope == scope) {
+                return slots[i].value;
+            }
+            i = (i + 1) & mask;
+        }
+        return nullptr;
+    }
+
+    // Adds name to the scope unless it is already declared there, in which case
+    // the first entry is kept and false is returned
+    bool insert(ScopeId scope, Symbol name, const entry& value) {
+        // Keep the load factor under one half
+        if ((used + 1) * 2 > slots.size()) {
+            grow();
+        }
+        size_t i = hash(scope, name) & mask;
+        while (slots[i].name != NO_SYMBOL) {
+            if (slots[i].name == name && slots[i].scope == scope) {
+                return false;
+            }
+            i = (i + 1) & mask;
+        }
+        entries.push_back(value);
+        slots[i] = {scope, name, &entries.back()};
+        used++;
+        return true;
+    }
+
+    size_t size() const {
+        return used;
+    }
+
+    size_t numScopes() const {
+        return scopes;
+    }
+
+    // Bytes held by the table, reported with --stats
+    size_t memoryUsed() const {
+        return slots.capacity() * sizeof(Slot) + entries.size() * sizeof(entry) + signatureBytes;
+    }
+};
+
+#endif
@@ -0,0 +1,29 @@
+#!/usr/bin/env python3
+# Writes the inputs of 'make lexbench': a comment-heavy and a string-heavy
+# program of about the given number of megabytes each.
+#
+# Usage: lexbench.py DIR [MEGABYTES]
+
+import os
+import sys
+
+def write(path, line, megabytes):
+    count = megabytes * 1000000 // len(line)
+    with open(path, "w") as out:
+        out.write("main() {\n")
+        for _ in range(count):
+            out.write(line)
+        out.write("}\n")
+
+def main():
+    if len(sys.argv) < 2:
+        sys.exit("usage: lexbench.py DIR [MEGABYTES]")
+    directory = sys.argv[1]
+    megabytes = int(sys.argv[2]) if len(sys.argv) > 2 else 50
+    os.makedirs(directory, exist_ok=True)
+    write(os.path.join(directory, "comments.j--"),
+          "    x = x + 1; // a comment long enough to be most of the line, as in commented code\n", megabytes)
+    write(os.path.join(directory, "strings.j--"),
+          '    prints("a string literal that makes up most of the line, with an \\" escape\\n");\n', megabytes)
+
+main()
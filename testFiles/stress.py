@@ -0,0 +1,40 @@
+#!/usr/bin/env python3
+# Writes the deeply nested programs of 'make stress'. Each one computes
+# DEPTH in a construct nested DEPTH levels deep and prints it, so the
+# assembly of a successful compilation loads that constant.
+#
+# Usage: stress.py DIR [DEPTH]
+
+import os
+import sys
+
+def plus_chain(depth):
+    return "main() { int x; x = " + "+".join(["1"] * depth) + "; printi(x); }\n"
+
+def nested_parens(depth):
+    return "main() { int x; x = " + "(" * (depth - 1) + "1" + "+1)" * (depth - 1) + "; printi(x); }\n"
+
+def nested_blocks(depth):
+    return "main() { int x; x = 0; " + "{ x = x + 1; " * depth + "}" * depth + " printi(x); }\n"
+
+def nested_ifs(depth):
+    return "main() { int x; x = 0; " + "if (x >= 0) { x = x + 1; " * depth + "}" * depth + " printi(x); }\n"
+
+SHAPES = {
+    "plus": plus_chain,
+    "parens": nested_parens,
+    "blocks": nested_blocks,
+    "ifs": nested_ifs,
+}
+
+def main():
+    if len(sys.argv) < 2:
+        sys.exit("usage: stress.py DIR [DEPTH]")
+    directory = sys.argv[1]
+    depth = int(sys.argv[2]) if len(sys.argv) > 2 else 1000000
+    os.makedirs(directory, exist_ok=True)
+    for name, shape in SHAPES.items():
+        with open(os.path.join(directory, name + ".j--"), "w") as out:
+            out.write(shape(depth))
+
+main()
@@ -0,0 +1,92 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+Runs a fixed number of jobs on a pool of threads that steal work from each other.
+Each thread starts with an even, contiguous share of the job numbers in a queue of
+its own, takes its next job from the back of that queue and, once it runs out,
+steals from the front of the other queues. A thread left with a few large jobs
+then doesn't keep the others waiting. No job is added once the pool runs, so a
+thread is done when every queue is empty.
+*/
+class WorkStealingPool
+{
+    private:
+    struct Queue {
+        std::mutex lock;
+        std::deque<size_t> jobs;
+    };
+
+    std::vector<Queue> queues;
+
+    bool take(unsigned worker, size_t& job) {
+        Queue& queue = queues[worker];
+        std::lock_guard<std::mutex> guard(queue.lock);
+        if (queue.jobs.empty()) {
+            return false;
+        }
+        job = queue.jobs.back();
+        queue.jobs.pop_back();
+        return true;
+    }
+
+    bool steal(unsigned worker, size_t& job) {
+        for (size_t i = 1; i < queues.size(); i++) {
+            Queue& victim = queues[(worker + i) % queues.size()];
+            std::lock_guard<std::mutex> guard(victim.lock);
+            if (!victim.jobs.empty()) {
+                job = victim.jobs.front();
+                victim.jobs.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    template <typename Job>
+    void work(unsigned worker, Job& run) {
+        size_t job;
+        while (take(worker, job) || steal(worker, job)) {
+            run(job, worker);
+        }
+    }
+
+    public:
+    // Uses one thread per core when numThreads is 0
+    WorkStealingPool(unsigned numThreads = 0)
+        : queues(numThreads > 0 ? numThreads : std::max(1u, std::thread::hardware_concurrency())) {}
+
+    unsigned numThreads() const {
+        return queues.size();
+    }
+
+    // Calls run(job, worker) for every job in [0, numJobs), where worker is the
+    // number of the thread running it, and returns when all of them are done.
+    // The calling thread is worker 0.
+    template <typename Job>
+    void run(size_t numJobs, Job run) {
+        size_t n = queues.size();
+        for (size_t worker = 0; worker < n; worker++) {
+            for (size_t job = numJobs * worker / n; job < numJobs * (worker + 1) / n; job++) {
+                queues[worker].jobs.push_back(job);
+            }
+        }
+        std::vector<std::thread> threads;
+        for (unsigned worker = 1; worker < n; worker++) {
+            threads.emplace_back([this, worker, &run] { work(worker, run); });
+        }
+        work(0, run);
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef VISITOR_HPP
+#define VISITOR_HPP
+
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "ast.hpp"
+
+/*
+Base class of the passes that walk the abstract syntax tree. A pass derives from
+Visitor<Pass> and hides enter, called before a node's children, and/or leave,
+called after them. walk() calls the hooks through the derived type, so each call
+is resolved at compile time instead of going through a function pointer.
+
+The walk keeps the path from the root to the current node on an explicit stack of
+(node, index of the next child) pairs and reads the children in place, so it
+neither recurses nor copies any child lists.
+*/
+template <typename Derived>
+class Visitor {
+    public:
+
+    void enter(AST* node) {}
+
+    void leave(AST* node) {}
+
+    void walk(AST* root) {
+        Derived& pass = static_cast<Derived&>(*this);
+        std::vector<std::pair<AST*, int>> path;
+        pass.enter(root);
+        path.push_back({root, 0});
+        while (!path.empty()) {
+            AST* node = path.back().first;
+            int next = path.back().second;
+            if (next < node->numChildren()) {
+                path.back().second++;
+                AST* child = node->getChild(next);
+                pass.enter(child);
+                path.push_back({child, 0});
+            }
+            else {
+                pass.leave(node);
+                path.pop_back();
+            }
+        }
+    }
+};
+
+/*
+Runs several passes in a single walk. Each node is entered by every pass in the
+order they are given, then its children are walked, then it is left by the passes
+in the reverse order, so a pass listed first brackets the ones after it. The
+passes are held by reference and keep their own state.
+*/
+template <typename... Passes>
+class FusedVisitor : public Visitor<FusedVisitor<Passes...>> {
+    public:
+
+    FusedVisitor(Passes&... passes) : passes(passes...) {}
+
+    void enter(AST* node) {
+        forEach([node](auto& pass) { pass.enter(node); }, std::index_sequence_for<Passes...>());
+    }
+
+    void leave(AST* node) {
+        forEachReversed([node](auto& pass) { pass.leave(node); }, std::index_sequence_for<Passes...>());
+    }
+
+    private:
+    std::tuple<Passes&...> passes;
+
+    template <typename Hook, std::size_t... I>
+    void forEach(Hook hook, std::index_sequence<I...>) {
+        int expand[] = {0, (hook(std::get<I>(passes)), 0)...};
+        (void)expand;
+    }
+
+    template <typename Hook, std::size_t... I>
+    void forEachReversed(Hook hook, std::index_sequence<I...>) {
+        int expand[] = {0, (hook(std::get<sizeof...(Passes) - 1 - I>(passes)), 0)...};
+        (void)expand;
+    }
+};
+
+// Walks root once with all of the given passes
+template <typename... Passes>
+void walkFused(AST* root, Passes&... passes) {
+    FusedVisitor<Passes...>(passes...).walk(root);
+}
+
+#endif